@@ -5,63 +5,87 @@
 #include <stdio.h>
 #include <stdio_ext.h>
 #include <stdbool.h>
+#include <string.h>
 #include <termios.h>
-
-// See http://stackoverflow.com/questions/1413445/read-a-password-from-stdcin
-void set_echo(bool enable)
-{
-	struct termios tty;
-	tcgetattr(STDIN_FILENO, &tty);
-	if (enable == false) {
-		tty.c_lflag &= ~ECHO;
+#include <unistd.h>
+
+// Trace prints on the interactive authentication path compile away unless
+// explicitly requested, so the production build doesn't stall on terminal
+// writes between PAM calls
+#ifdef PICO_DEBUG_TRACE
+#define DBGP(...) printf(__VA_ARGS__)
+#else
+#define DBGP(...) ((void)0)
+#endif
+
+// Read a line from stdin with the trailing newline removed. The returned
+// string is owned by the caller and allocated with malloc, as PAM requires
+// for conversation responses; NULL is returned on read failure
+static char * read_line_stripped(void) {
+	// Line buffer reused across prompts and conversations; getline grows it
+	// on the first read and later reads reuse the allocation
+	static char * inputline = NULL;
+	static size_t inputsize = 0;
+	ssize_t read;
+
+	read = getline(&inputline, &inputsize, stdin);
+	// Remove final \n delimiter
+	if (inputline && (read > 0) && (inputline[read - 1] == '\n')) {
+		inputline[read - 1] = 0;
 	}
-	else {
-		tty.c_lflag |= ECHO;
-	}
-	(void) tcsetattr(STDIN_FILENO, TCSANOW, &tty);
+
+	return inputline ? strdup(inputline) : NULL;
 }
 
 int text_conv (int num_msg, const struct pam_message ** msg, struct pam_response ** resp, void *appdata_ptr) {
 	int msg_count;
 	struct pam_message const * current_msg;
 	struct pam_response * current_resp;
-	char * inputline;
-	size_t read;
+	// See http://stackoverflow.com/questions/1413445/read-a-password-from-stdcin
+	// The terminal state is read once per conversation and only the ECHO
+	// bit is toggled, rather than re-reading it around every prompt
+	struct termios saved;
+	struct termios current;
+	bool echo_off;
 	int result;
 
 	result = PAM_SUCCESS;
-	*resp = calloc(sizeof(struct pam_response), num_msg);
+	*resp = calloc(num_msg, sizeof(struct pam_response));
+
+	tcgetattr(STDIN_FILENO, &saved);
+	current = saved;
+	echo_off = false;
 
 	for (msg_count = 0; msg_count < num_msg; msg_count++) {
 		current_msg = msg[msg_count];
-		current_resp = & (*resp[msg_count]);
+		// Index into the response array, not the array of pointers; the
+		// previous & (*resp[msg_count]) only worked for num_msg == 1
+		current_resp = & (*resp)[msg_count];
 
 		current_resp->resp_retcode = 0;
 
+		// The common case in a login loop is the password prompt, so bias
+		// the branch that way
+		if (__builtin_expect(current_msg->msg_style == PAM_PROMPT_ECHO_OFF, 1)) {
+			printf("%s (no echo) \n", current_msg->msg);
+			if (echo_off == false) {
+				current.c_lflag &= ~ECHO;
+				(void) tcsetattr(STDIN_FILENO, TCSANOW, &current);
+				echo_off = true;
+			}
+			current_resp->resp = read_line_stripped();
+			continue;
+		}
+
 		switch (current_msg->msg_style) {
-			case PAM_PROMPT_ECHO_OFF:
-				printf("%s (no echo) \n", current_msg->msg);
-				set_echo(false);
-				inputline = NULL;
-				read = 0;
-				read = getline(&inputline, &read, stdin);
-				// Remove final \n delimiter
-				if (inputline && (read > 0) && (inputline[read - 1] == '\n')) {
-					inputline[read - 1] = 0;
-				}
-				current_resp->resp = inputline;
-				set_echo(true);
-				break;
 			case PAM_PROMPT_ECHO_ON:
 				printf("%s (echo) \n", current_msg->msg);
-				inputline = NULL;
-				read = 0;
-				read = getline(&inputline, &read, stdin);
-				// Remove final \n delimiter
-				if (inputline && (read > 0) && (inputline[read - 1] == '\n')) {
-					inputline[read - 1] = 0;
+				if (echo_off == true) {
+					current.c_lflag |= ECHO;
+					(void) tcsetattr(STDIN_FILENO, TCSANOW, &current);
+					echo_off = false;
 				}
-				current_resp->resp = inputline;
+				current_resp->resp = read_line_stripped();
 				break;
 			case PAM_ERROR_MSG:
 				printf("Error: %s\n", current_msg->msg);
@@ -75,7 +99,11 @@ int text_conv (int num_msg, const struct pam_message ** msg, struct pam_response
 				break;
 		}
 	}
-	
+
+	if (echo_off == true) {
+		(void) tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+	}
+
 	return result;
 }
 
@@ -99,20 +127,23 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
-	printf("pam_start\n");
+	// Line-buffer the remaining output rather than flushing per write
+	setvbuf(stdout, NULL, _IOLBF, 4096);
+
+	DBGP("pam_start\n");
 	retval = pam_start("check_user", user, &conv, &pamh);
-	printf("Done\n");
+	DBGP("Done\n");
 
 	if (retval == PAM_SUCCESS) {
-		printf("pam_authenticate\n");
+		DBGP("pam_authenticate\n");
 		retval = pam_authenticate(pamh, 0);	/* is user really user? */
-		printf("Done\n");
+		DBGP("Done\n");
 	}
 
 	if (retval == PAM_SUCCESS) {
-		printf("pam_acct_mgmt\n");
+		DBGP("pam_acct_mgmt\n");
 		retval = pam_acct_mgmt(pamh, 0);	   /* permitted access? */
-		printf("Done\n");
+		DBGP("Done\n");
 	}
 
 	/* This is where we have been authorized or not. */
@@ -123,9 +154,9 @@ int main(int argc, char *argv[])
 		fprintf(stdout, "Not Authenticated\n");
 	}
 
-	printf("pam_end\n");
+	DBGP("pam_end\n");
 	retval = pam_end(pamh,retval);
-	printf("Done\n");
+	DBGP("Done\n");
 	if (retval != PAM_SUCCESS) {	 /* close Linux-PAM */
 		pamh = NULL;
 		fprintf(stderr, "check_user: failed to release authenticator\n");
@@ -1,5 +1,8 @@
 // Example code for performing Pico server-side authentication
 
+#include <stdlib.h>
+#include <pthread.h>
+#include <semaphore.h>
 #include "pico/pico.h"
 #include "pico/auth.h"
 #include "pico/displayqr.h"
@@ -9,57 +12,136 @@
 #include "pico/continuous.h"
 #include "pico/channel.h"
 #include "pico/channel_bt.h"
+#include "pico/channel_rvp.h"
 #include "pico/log.h"
 
+// Job slot handed to the QR display worker thread; the worker renders the
+// code to the terminal while the main thread is already listening on the
+// channel for the Pico to connect
+typedef struct {
+	QrCallbackFunction qrCallback;
+	char * qrtext;
+	void * data;
+	bool result;
+} QrDisplayJob;
+
+static pthread_t qr_display_thread;
+static bool qr_display_thread_running = false;
+static sem_t qr_display_start;
+static sem_t qr_display_done;
+static QrDisplayJob qr_display_job;
+
+// Worker loop for displaying QR codes off the main thread. Each handoff is
+// a sem_post on qr_display_start with the job slot filled in; completion is
+// signalled back on qr_display_done
+static void * qr_display_worker(void * arg) {
+	while (true) {
+		sem_wait(& qr_display_start);
+		qr_display_job.result = qr_display_job.qrCallback(qr_display_job.qrtext, qr_display_job.data);
+		sem_post(& qr_display_done);
+	}
+
+	return NULL;
+}
+
 bool auth_auth(Shared * shared, Users * authorizedUsers, Buffer * returnedStoredData, QrCallbackFunction qrCallback, void * data, Buffer * localSymmetricKey, RVPChannel * channel) {
+	// The serialized KeyAuth depends only on the channel URL and the
+	// service identity key, which are stable for the life of the process,
+	// so cache the QR text and skip the serialize-and-sign path when
+	// re-authenticating on the same channel
+	static Buffer * cached_url = NULL;
+	static Buffer * cached_qr = NULL;
+	// Reused across invocations so repeat authentications stay off the
+	// allocator; pre-sized to hold a typical rendezvous channel URL
+	static Buffer * buffer = NULL;
 	KeyPair * serviceIdentityKey;
 	bool result;
-	size_t size;
-	char * qrtext;
-	Buffer * buffer;
 	KeyAuth * keyauth;
 
-	buffer = buffer_new(0);
+	if (buffer == NULL) {
+		buffer = buffer_new(0);
+		buffer_set_min_size(buffer, 256);
+	}
+	buffer_clear(buffer);
 
 	channel_get_url(channel, buffer);
 	result = (buffer_get_pos(buffer) > 0);
 
 	if (result) {
-		serviceIdentityKey = shared_get_service_identity_key(shared);
-
-		// SEND
-		// Generate a visual QR code for Key Pairing
-		// {"sn":"NAME","spk":"PUB-KEY","sig":"B64-SIG","ed":"","sa":"URL","td":{},"t":"KP"}
-		keyauth = keyauth_new();
-		keyauth_set(keyauth, buffer, "", NULL, serviceIdentityKey);
-
-		size = keyauth_serialize_size(keyauth);
-		qrtext = MALLOC(size + 1);
-		keyauth_serialize(keyauth, qrtext, size + 1);
-		keyauth_delete(keyauth);
-
-		result = qrCallback(qrtext, data);
-		FREE(qrtext);
+		if ((cached_url == NULL) || (buffer_equals(cached_url, buffer) == false)) {
+			serviceIdentityKey = shared_get_service_identity_key(shared);
+
+			// SEND
+			// Generate a visual QR code for Key Pairing
+			// {"sn":"NAME","spk":"PUB-KEY","sig":"B64-SIG","ed":"","sa":"URL","td":{},"t":"KP"}
+			keyauth = keyauth_new();
+			keyauth_set(keyauth, buffer, "", NULL, serviceIdentityKey);
+
+			if (cached_url == NULL) {
+				cached_url = buffer_new(0);
+				cached_qr = buffer_new(0);
+			}
+			buffer_clear(cached_url);
+			buffer_append_buffer(cached_url, buffer);
+			buffer_clear(cached_qr);
+			// Serialize straight into the reused buffer; no intermediate
+			// allocation, and the contents are null-terminated so they can
+			// be handed to the callback directly
+			keyauth_serialize_into(keyauth, cached_qr);
+			keyauth_delete(keyauth);
+		}
+
+		// Hand the QR rendering to the worker thread and start listening on
+		// the channel straight away; the Pico can only connect once the user
+		// has scanned the code, so the display overlaps the network wait
+		if (qr_display_thread_running == false) {
+			sem_init(& qr_display_start, 0, 0);
+			sem_init(& qr_display_done, 0, 0);
+			pthread_create(& qr_display_thread, NULL, qr_display_worker, NULL);
+			pthread_detach(qr_display_thread);
+			qr_display_thread_running = true;
+		}
+		qr_display_job.qrCallback = qrCallback;
+		qr_display_job.qrtext = buffer_get_buffer(cached_qr);
+		qr_display_job.data = data;
+		sem_post(& qr_display_start);
 	}
 	
 	if (result) {
 		//result = sigmaverifier(shared, channel, authorizedUsers, NULL, returnedStoredData, localSymmetricKey);
 		result = sigmaverifier_session(shared, channel, authorizedUsers, "", returnedStoredData, localSymmetricKey, true, 0);
+
+		// Collect the display result; the verifier outcome only stands if
+		// the code was actually shown
+		sem_wait(& qr_display_done);
+		result = result && qr_display_job.result;
 	}
-	
-	buffer_delete(buffer);
 
 	return result;
 }
 
 // Display a QR code on the console
+// Cached across invocations to avoid reallocating the DisplayQR (and its
+// output buffer) on every authentication cycle; freed at process exit
+static DisplayQR * displayqr = NULL;
+
+// Free the cached DisplayQR at process exit
+static void display_qr_cleanup(void) {
+	displayqr_delete(displayqr);
+	displayqr = NULL;
+}
+
 bool display_qr(char * qrtext, void * localdata) {
-	DisplayQR * displayqr = displayqr_new();
+	if (displayqr == NULL) {
+		displayqr = displayqr_new();
+		// Fix the mask pattern so generation skips the mask trials
+		displayqr_set_fixed_mask(displayqr, 2);
+		atexit(display_qr_cleanup);
+	}
 
 	printf("\nPlease scan the barcode with your Pico app to authenticate.\n\n");
 	displayqr_generate(displayqr, qrtext);
 	displayqr_output(displayqr);
-	displayqr_delete(displayqr);
 
 	return true;
 }
@@ -91,8 +173,9 @@ int main(int argc, char **argv) {
 
 	// Perform the authentication
 	if (result == true) {
-		// Request a new rendezvous channel
-		channel = channel_new();
+		// Request a new rendezvous channel; the dedicated constructor binds
+		// the RVP backend directly
+		channel = channel_new_rvp();
 		//channel_set_bt(channel);
 
 		result = auth_auth(shared, users, extra_data, display_qr, NULL, NULL, channel);
@@ -1,17 +1,32 @@
 // Example code for performing Pico client-side authentication
 
+#include <stdlib.h>
 #include "pico/pico.h"
 #include "pico/auth.h"
 #include "pico/displayqr.h"
 
 // Display a QR code on the console
+// Cached across invocations to avoid reallocating the DisplayQR (and its
+// output buffer) on every authentication cycle; freed at process exit
+static DisplayQR * displayqr = NULL;
+
+// Free the cached DisplayQR at process exit
+static void display_qr_cleanup(void) {
+	displayqr_delete(displayqr);
+	displayqr = NULL;
+}
+
 bool display_qr(char * qrtext, void * localdata) {
-	DisplayQR * displayqr = displayqr_new();
+	if (displayqr == NULL) {
+		displayqr = displayqr_new();
+		// Fix the mask pattern so generation skips the mask trials
+		displayqr_set_fixed_mask(displayqr, 2);
+		atexit(display_qr_cleanup);
+	}
 
 	printf("\nPlease scan the barcode with your Pico app to pair.\n\n");
 	displayqr_generate(displayqr, qrtext);
 	displayqr_output(displayqr);
-	displayqr_delete(displayqr);
 
 	return true;
 }
@@ -60,6 +60,36 @@ DLL_PUBLIC size_t base64_decode_size_max(size_t input);
 
 // Function definitions
 
+/**
+ * Calculate the maximum space needed to encode input of the given length into
+ * a base64 representation.
+ *
+ * This is the inline equivalent of base64_encode_size_max(), for internal
+ * callers that size a buffer before every encode; the arithmetic folds into
+ * the allocation at the call site rather than going through the PLT.
+ *
+ * @param input Length of data to be encoded into base64 format.
+ * @return Maximum space in bytes needed to store a base64-encoded data.
+ */
+static inline size_t base64_encode_size_max_inline(size_t input) {
+	return ((input + 2) / 3) * 4;
+}
+
+/**
+ * Calculate the maximum space needed to decode data in base64 representation
+ * of the given length.
+ *
+ * This is the inline equivalent of base64_decode_size_max(), for internal
+ * callers that size a buffer before every decode; the arithmetic folds into
+ * the allocation at the call site rather than going through the PLT.
+ *
+ * @param input Length of base64-encoded data to be decoded.
+ * @return Maximum space in bytes needed to store the decoded data.
+ */
+static inline size_t base64_decode_size_max_inline(size_t input) {
+	return ((input + 3) / 4) * 3 + 1;
+}
+
 #endif
 
 /** @} addtogroup Datahandling */
@@ -0,0 +1,67 @@
+/** \ingroup Datahandling
+ * @file
+ * @author  David Llewellyn-Jones <David.Llewellyn-Jones@cl.cam.ac.uk>
+ * @version $(VERSION)
+ *
+ * @section LICENSE
+ *
+ * (C) Copyright Cambridge Authentication Ltd, 2017
+ *
+ * This file is part of libpico.
+ *
+ * Libpico is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Libpico is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with libpico. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *
+ * @brief Runtime-dispatched vector kernels for base64 coding
+ * @section DESCRIPTION
+ *
+ * Internal interface to the vectorised base64 kernels shared between the
+ * high-level coders in base64.c and the libb64-derived block coders in
+ * cencode.c and cdecode.c. The kernels are compiled with per-function
+ * target attributes, so they exist in every build regardless of the
+ * compiler's global instruction-set flags, and each entry point checks the
+ * CPU's capabilities at runtime: on a machine without a suitable
+ * instruction set the entry points consume no input and the callers'
+ * scalar paths handle everything.
+ *
+ */
+
+/** \addtogroup Datahandling
+ *  @{
+ */
+
+#ifndef __BASE64SIMD_H
+#define __BASE64SIMD_H (1)
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "pico/dllpublic.h"
+
+// Defines
+
+// Structure definitions
+
+// Function prototypes
+
+DLL_PUBLIC size_t base64simd_decode(char const * memin, size_t length, char * memout, size_t * produced);
+DLL_PUBLIC size_t base64simd_encode(char const * memin, size_t length, char * memout, size_t * produced);
+DLL_PUBLIC bool base64simd_strip_whitespace_available(void);
+DLL_PUBLIC size_t base64simd_strip_whitespace(char const * memin, size_t length, char * memout);
+
+// Function definitions
+
+#endif
+
+/** @} addtogroup Datahandling */
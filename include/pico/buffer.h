@@ -85,6 +85,7 @@ DLL_PUBLIC size_t buffer_copy_to_string(Buffer const * buffer, char * string, si
 DLL_PUBLIC char * buffer_copy_to_new_string(Buffer const * buffer);
 DLL_PUBLIC size_t buffer_get_pos(Buffer const * buffer);
 DLL_PUBLIC char * buffer_get_buffer(Buffer const * buffer);
+DLL_PUBLIC char const * buffer_cstr(Buffer const * buffer);
 DLL_PUBLIC void buffer_set_min_size(Buffer * buffer, size_t size);
 DLL_PUBLIC size_t buffer_get_size(Buffer const * buffer);
 DLL_PUBLIC void buffer_set_pos(Buffer * buffer, size_t pos);
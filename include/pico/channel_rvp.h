@@ -55,9 +55,18 @@
 
 // Function prototypes
 
+DLL_PUBLIC RVPChannel * channel_new_rvp();
 DLL_PUBLIC bool channel_set_rvp(RVPChannel * channel);
 DLL_PUBLIC bool channel_decode_url_rvp(char const * url, Buffer * address, Buffer * channel);
 
+// Concrete implementations of the channel operations. Callers that know at
+// compile time that they are using a Rendezvous Point channel can call these
+// directly, avoiding the indirect dispatch through the RVPChannel function
+// pointers on every operation.
+DLL_PUBLIC bool channel_read_rvp(RVPChannel * channel, Buffer * buffer);
+DLL_PUBLIC bool channel_write_rvp(RVPChannel * channel, char * data, int length);
+DLL_PUBLIC void channel_get_url_rvp(RVPChannel * channel, Buffer * buffer);
+
 // Function definitions
 
 #endif
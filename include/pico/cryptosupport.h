@@ -32,6 +32,13 @@
  * and macs are supported, as well as functionality for encoding and decoding
  * keys in various formats.
  *
+ * The encrypt and decrypt functions are authenticated encryption (AES-128
+ * in GCM mode): the ciphertext carries its own integrity tag and decryption
+ * fails if the tag doesn't verify, so no separate MAC pass is needed over
+ * encrypted payloads. The cryptosupport_generate_mac function exists for
+ * the protocol's standalone identity-key MACs, not for protecting
+ * ciphertexts.
+ *
  */
 
 /** \addtogroup Utility
@@ -69,7 +76,7 @@
 
 DLL_PUBLIC bool cryptosupport_getpublicpem(EC_KEY * eckey, Buffer * buffer);
 DLL_PUBLIC bool cryptosupport_getpublicder(EC_KEY * eckey, Buffer * buffer);
-DLL_PUBLIC bool cryptosupport_getprivatepem(EVP_PKEY * pkey, Buffer * buffer);
+DLL_LOCAL bool cryptosupport_getprivatepem(EVP_PKEY * pkey, Buffer * buffer);
 DLL_PUBLIC bool cryptosupport_getprivateder(EVP_PKEY * pkey, Buffer * buffer);
 DLL_PUBLIC bool cryptosupport_generate_mac(Buffer * macKey, Buffer * data, Buffer * bufferout);
 DLL_PUBLIC bool cryptosupport_verify_signature(EC_KEY const * publickey, Buffer const * bufferin, Buffer * sigin);
@@ -87,8 +94,8 @@ DLL_PUBLIC EC_KEY * cryptosupport_read_base64_buffer_public_key(Buffer * keybuff
 DLL_PUBLIC EC_KEY * cryptosupport_read_base64_string_public_key(char const * keystring);
 DLL_PUBLIC EC_KEY * cryptosupport_read_buffer_public_key(Buffer * keybuffer);
 
-DLL_PUBLIC EVP_PKEY * cryptosupport_read_base64_buffer_private_key(Buffer * keybuffer);
-DLL_PUBLIC EVP_PKEY * cryptosupport_read_base64_string_private_key(char const * keystring);
+DLL_LOCAL EVP_PKEY * cryptosupport_read_base64_buffer_private_key(Buffer * keybuffer);
+DLL_LOCAL EVP_PKEY * cryptosupport_read_base64_string_private_key(char const * keystring);
 DLL_PUBLIC EVP_PKEY * cryptosupport_read_buffer_private_key(Buffer * keybuffer);
 
 
@@ -42,6 +42,8 @@
 #define __DEBUG_H (1)
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 // Defines
 
@@ -57,7 +59,11 @@
 #define DEBUG_FINAL debug_final()
 #else
 #define MALLOC malloc
+#if defined(__GNUC__) || defined(__clang__)
+#define CALLOC pico_calloc
+#else
 #define CALLOC calloc
+#endif
 #define REALLOC realloc
 #define FREE free
 #define DEBUG_INIT
@@ -80,6 +86,36 @@ void debug_free (void *__ptr);
 
 // Function definitions
 
+#if defined(__GNUC__) || defined(__clang__)
+/**
+ * Allocate a zeroed array of nmemb elements of the given size, checking the
+ * element count against overflow with a single flag test rather than a
+ * division. Unlike a call into libc calloc, the clearing memset is visible
+ * to the compiler here, so it can be elided when the caller immediately
+ * overwrites the whole block.
+ *
+ * @param nmemb The number of elements to allocate.
+ * @param size The size of each element in bytes.
+ * @return A pointer to the zeroed block, or NULL on overflow or allocation
+ *         failure.
+ */
+static inline __attribute__((always_inline)) void * pico_calloc(size_t nmemb, size_t size) {
+	size_t bytes;
+	void * block;
+
+	if (__builtin_expect(__builtin_mul_overflow(nmemb, size, &bytes), 0)) {
+		return NULL;
+	}
+
+	block = malloc(bytes);
+	if (block != NULL) {
+		memset(block, 0, bytes);
+	}
+
+	return block;
+}
+#endif
+
 #endif
 
 /** @} addtogroup Debug */
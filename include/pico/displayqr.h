@@ -58,6 +58,7 @@ typedef enum _QRMODE {
 DLL_PUBLIC DisplayQR * displayqr_new();
 DLL_PUBLIC DisplayQR * displayqr_new_params(QRMODE qr_mode);
 DLL_PUBLIC void displayqr_set_mode_params(DisplayQR * displayqr, void * param);
+DLL_PUBLIC void displayqr_set_fixed_mask(DisplayQR * displayqr, int mask);
 DLL_PUBLIC void displayqr_delete(DisplayQR * displayqr);
 DLL_PUBLIC size_t displayqr_generate(DisplayQR * displayqr, const char * text);
 DLL_PUBLIC void displayqr_output(DisplayQR * displayqr);
@@ -47,14 +47,25 @@
 #if defined(_WIN32) || defined(_WIN64)
 
 #define DLL_PUBLIC __declspec(dllexport)
+// Symbols are only exported from a DLL when explicitly listed, so there is
+// nothing extra to do to keep a symbol local
+#define DLL_LOCAL
 // Windows prefixed the function with _ for some questionable reasons
 // In some versions of the compiler
 #if defined(_MSC_VER) && (_MSC_VER < 1900) && !defined(snprintf)
 #define snprintf _snprintf
 #endif
 
+#elif defined(__GNUC__) && (__GNUC__ >= 4)
+// Mark exported symbols with default visibility explicitly, so the library
+// can also be built with -fvisibility=hidden, and internal symbols as hidden
+// so calls to them from inside the library skip the PLT and can be inlined
+// across translation units when building with LTO
+#define DLL_PUBLIC __attribute__ ((visibility ("default")))
+#define DLL_LOCAL __attribute__ ((visibility ("hidden")))
 #else
 #define DLL_PUBLIC
+#define DLL_LOCAL
 #endif
 
 
@@ -41,6 +41,7 @@
 #ifndef __FEEDBACK_H
 #define __FEEDBACK_H (1)
 
+#include <stdint.h>
 #include "pico/buffer.h"
 #include "pico/dllpublic.h"
 
@@ -68,17 +69,6 @@ typedef enum _FEEDBACKAUTHVERIFIER {
 	FEEDBACKAUTHVERIFIER_NUM
 } FEEDBACKAUTHVERIFIER;
 
-static char const * const authVerifierFeedback[FEEDBACKAUTHVERIFIER_NUM] = {
-	"Starting up",
-	"Generating keys",
-	"Ready to log in",
-	"Contacted the Pico app",
-	"Authenticating computer",
-	"Authenticating you",
-	"Authentication complete",
-	"Finalising",
-	"Finalised"
-};
 
 typedef enum _FEEDBACKAUTHPROVER {
 	FEEDBACKAUTHPROVER_INVALID = -1,
@@ -93,14 +83,33 @@ typedef enum _FEEDBACKAUTHPROVER {
 	FEEDBACKAUTHPROVER_NUM
 } FEEDBACKAUTHPROVER;
 
-static char const * const authProverFeedback[FEEDBACKAUTHPROVER_NUM] = {
-	"Initialising",
-	"Contacting service",
-	"Authenticating service",
-	"Authenticating Pico",
-	"Waiting for result",
-	"Sigma protocol complete"
-};
+// Stage description strings, packed end to end with a dense offset table
+// and defined once in feedback.c, rather than as per-translation-unit
+// static pointer arrays
+extern char const feedbackAuthVerifierStrings[];
+extern uint8_t const feedbackAuthVerifierOffsets[FEEDBACKAUTHVERIFIER_NUM];
+extern char const feedbackAuthProverStrings[];
+extern uint8_t const feedbackAuthProverOffsets[FEEDBACKAUTHPROVER_NUM];
+
+/**
+ * Return the description of the given verifier authentication stage.
+ *
+ * @param stage The FEEDBACKAUTHVERIFIER stage to describe.
+ * @return The stage description as a null-terminated string.
+ */
+static inline char const * feedback_verifier_description(FEEDBACKAUTHVERIFIER stage) {
+	return & feedbackAuthVerifierStrings[feedbackAuthVerifierOffsets[stage]];
+}
+
+/**
+ * Return the description of the given prover authentication stage.
+ *
+ * @param stage The FEEDBACKAUTHPROVER stage to describe.
+ * @return The stage description as a null-terminated string.
+ */
+static inline char const * feedback_prover_description(FEEDBACKAUTHPROVER stage) {
+	return & feedbackAuthProverStrings[feedbackAuthProverOffsets[stage]];
+}
 
 // Function prototypes
 
@@ -108,11 +117,14 @@ Feedback * feedback_new();
 void feedback_delete(Feedback * feedback);
 void feedback_set_trigger(Feedback * feedback, FeedbackTrigger trigger, void * data);
 
+#ifndef PICO_INLINE_FEEDBACK
 DLL_PUBLIC int feedback_get_stage(Feedback const * const feedback);
 DLL_PUBLIC int feedback_get_max_stages(Feedback const * const feedback);
 DLL_PUBLIC double feedback_get_progress(Feedback const * const feedback);
 DLL_PUBLIC char const * feedback_get_description(Feedback const * const feedback);
 DLL_PUBLIC int feedback_get_special_removeqr(Feedback const * const feedback);
+#endif
+DLL_PUBLIC uint32_t feedback_consume_events(Feedback * feedback);
 
 // The following functions are for internal use
 void feedback_reset(Feedback * feedback, int stages);
@@ -122,6 +134,35 @@ void feedback_set_special_removeqr(Feedback * feedback, int stage);
 
 // Function definitions
 
+#ifdef PICO_INLINE_FEEDBACK
+// Header-inline accessors for applications that poll feedback state in
+// tight UI refresh loops. Defining PICO_INLINE_FEEDBACK exposes the
+// structure layout (see feedback_internal.h) and turns the getters into
+// direct field reads, avoiding a PLT call per poll. The out-of-line
+// DLL_PUBLIC versions remain in the library for ABI compatibility.
+#include "pico/feedback_internal.h"
+
+static inline int feedback_get_stage(Feedback const * const feedback) {
+	return feedback->stage;
+}
+
+static inline int feedback_get_max_stages(Feedback const * const feedback) {
+	return feedback->stages;
+}
+
+static inline double feedback_get_progress(Feedback const * const feedback) {
+	return (double)feedback->stage / (double)feedback->stages;
+}
+
+static inline char const * feedback_get_description(Feedback const * const feedback) {
+	return buffer_get_buffer(feedback->description);
+}
+
+static inline int feedback_get_special_removeqr(Feedback const * const feedback) {
+	return feedback->remove_qr;
+}
+#endif
+
 #endif
 
 /** @} addtogroup Protocol */
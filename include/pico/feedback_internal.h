@@ -0,0 +1,75 @@
+/** \ingroup Protocol
+ * @file
+ * @author  David Llewellyn-Jones <David.Llewellyn-Jones@cl.cam.ac.uk>
+ * @version $(VERSION)
+ *
+ * @section LICENSE
+ *
+ * (C) Copyright Cambridge Authentication Ltd, 2017
+ *
+ * This file is part of libpico.
+ *
+ * Libpico is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Libpico is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with libpico. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *
+ * @brief Internal structure layout for the Feedback class
+ * @section DESCRIPTION
+ *
+ * The Feedback structure layout, shared between feedback.c and the
+ * header-inline accessors that feedback.h provides when
+ * PICO_INLINE_FEEDBACK is defined. The layout is part of the inline
+ * accessor contract: changing it requires rebuilding any application
+ * compiled with PICO_INLINE_FEEDBACK.
+ *
+ */
+
+/** \addtogroup Protocol
+ *  @{
+ */
+
+#ifndef __FEEDBACK_INTERNAL_H
+#define __FEEDBACK_INTERNAL_H (1)
+
+#include <stdint.h>
+#include "pico/buffer.h"
+#include "pico/feedback.h"
+
+// Defines
+
+// Structure definitions
+
+struct _Feedback {
+	FeedbackTrigger trigger;
+	void * data;
+
+	int stage;
+	int stages;
+	Buffer * description;
+
+	// Special stages
+	int remove_qr;
+
+	// Bitmask of stages reached since the last feedback_consume_events()
+	// call; bit n is set when stage n is entered
+	uint32_t pending;
+};
+
+// Function prototypes
+
+// Function definitions
+
+#endif
+
+/** @} addtogroup Protocol */
@@ -46,6 +46,32 @@ typedef void (*FsmAuthenticated)(int status, void * user_data);
 typedef void (*FsmSessionEnded)(void * user_data);
 typedef void (*FsmStatusUpdate)(int state, void * user_data);
 
+/**
+ * @brief Callback table tying a state machine to its communication provider
+ *
+ * Both the Pico-side and service-side state machines dispatch through a
+ * single pointer to one of these tables, so each event touches one shared
+ * cache line rather than a spread of per-instance pointers. Each state
+ * machine owns its table: the function pointers passed to
+ * fsmpico_set_functions() or fsmservice_set_functions() are copied into
+ * the instance's table, so the caller keeps the existing registration
+ * interface and needs no knowledge of this structure.
+ *
+ * The reconnect member is used only by the Pico-side state machine and the
+ * listen member only by the service side; the other side ignores it.
+ */
+typedef struct _FsmCallbacks {
+	FsmWrite write;
+	FsmSetTimeout setTimeout;
+	FsmError error;
+	FsmReconnect reconnect;
+	FsmListen listen;
+	FsmDisconnect disconnect;
+	FsmAuthenticated authenticated;
+	FsmSessionEnded sessionEnded;
+	FsmStatusUpdate statusUpdate;
+} FsmCallbacks;
+
 #endif
 
 /** @} addtogroup Protocol */
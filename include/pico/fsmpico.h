@@ -57,6 +57,7 @@
 #ifndef __FSMPICO_H
 #define __FSMPICO_H (1)
 
+#include <stdint.h>
 #include "pico/fsm.h"
 
 // Defines
@@ -108,6 +109,7 @@ void fsmpico_set_userdata(FsmPico * fsmpico, void * user_data);
 void fsmpico_start(FsmPico * fsmpico, Buffer const * extraData, EC_KEY * serviceIdPubKey, EC_KEY * clientIdPubKey, EVP_PKEY * clientIdPrivKey);
 void fsmpico_stop(FsmPico * fsmpico);
 FSMPICOSTATE fsmpico_get_state(FsmPico * fsmpico);
+uint64_t fsmpico_get_deadline(FsmPico * fsmpico);
 void fsmpico_sendstop(FsmPico * fsmpico);
 
 
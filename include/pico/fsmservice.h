@@ -57,6 +57,7 @@
 #ifndef __FSMSERVICE_H
 #define __FSMSERVICE_H (1)
 
+#include <stdint.h>
 #include "pico/debug.h"
 #include "pico/log.h"
 #include "pico/shared.h"
@@ -114,12 +115,19 @@ DLL_PUBLIC Buffer const * fsmservice_get_user(FsmService * fsmservice);
 DLL_PUBLIC Buffer const * fsmservice_get_symmetric_key(FsmService * fsmservice);
 DLL_PUBLIC void fsmservice_set_continuous(FsmService * fsmservice, bool continuous);
 DLL_PUBLIC Buffer const * fsmservice_get_received_extra_data(FsmService * fsmservice);
+// Zero-copy alternatives to the three getters above; the spans point at
+// the state machine's internal storage and are valid until the next
+// fsmservice_stop (or next Pico message for the extra data)
+DLL_PUBLIC void fsmservice_borrow_user(FsmService * fsmservice, uint8_t const ** data, size_t * length);
+DLL_PUBLIC void fsmservice_borrow_symmetric_key(FsmService * fsmservice, uint8_t const ** data, size_t * length);
+DLL_PUBLIC void fsmservice_borrow_received_extra_data(FsmService * fsmservice, uint8_t const ** data, size_t * length);
 DLL_PUBLIC void fsmservice_set_outbound_extra_data(FsmService * fsmservice, Buffer const * extraData);
 
 // Use these functions to control the authentication process
 DLL_PUBLIC void fsmservice_start(FsmService * fsmservice, Shared * shared, Users const * users, Buffer const * extraData);
 DLL_PUBLIC void fsmservice_stop(FsmService * fsmservice);
 DLL_PUBLIC FSMSERVICESTATE fsmservice_get_state(FsmService * fsmservice);
+DLL_PUBLIC uint64_t fsmservice_get_deadline(FsmService * fsmservice);
 
 // Call these functions when an event occurs
 DLL_PUBLIC void fsmservice_read(FsmService * fsmservice, char const * data, size_t length);
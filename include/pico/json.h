@@ -75,6 +75,16 @@ typedef enum _JSONTYPE {
  */
 typedef struct _Json Json;
 
+/**
+ * Callback fired by json_scan() for each top-level key-value pair, in the
+ * order the pairs appear in the input. The key and value point into the
+ * string being scanned and bound the raw text, so for string values any
+ * escape sequences are left as they appear in the input and the text is
+ * not null-terminated. Return true to continue the scan or false to stop
+ * early, for example once all the fields of a fixed schema have been seen.
+ */
+typedef bool (*JsonScanCallback)(char const * key, size_t keylength, JSONTYPE type, char const * value, size_t valuelength, void * user_data);
+
 // Function prototypes
 
 DLL_PUBLIC Json * json_new();
@@ -89,6 +99,8 @@ DLL_PUBLIC size_t json_serialize(Json * json, char * buffer, size_t size);
 DLL_PUBLIC size_t json_serialize_buffer(Json * json, Buffer * buffer);
 DLL_PUBLIC bool json_deserialize_string(Json * json, char const * json_string, size_t length);
 DLL_PUBLIC bool json_deserialize_buffer(Json * json, Buffer const * buffer);
+DLL_PUBLIC bool json_scan(char const * json_string, size_t length, JsonScanCallback callback, void * user_data);
+DLL_PUBLIC bool json_scan_buffer(Buffer const * buffer, JsonScanCallback callback, void * user_data);
 DLL_PUBLIC void json_print(Json * json);
 DLL_PUBLIC void json_log(Json * json);
 DLL_PUBLIC JSONTYPE json_get_type(Json * json, char const * key);
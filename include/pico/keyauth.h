@@ -69,6 +69,7 @@ DLL_PUBLIC void keyauth_print(KeyAuth * keyauth);
 DLL_PUBLIC void keyauth_log(KeyAuth * keyauth);
 DLL_PUBLIC size_t keyauth_serialize_size(KeyAuth * keyauth);
 DLL_PUBLIC size_t keyauth_serialize(KeyAuth * keyauth, char * buffer, size_t size);
+DLL_PUBLIC size_t keyauth_serialize_into(KeyAuth * keyauth, Buffer * buffer);
 
 // Function definitions
 
@@ -59,6 +59,7 @@ typedef struct _KeyPair KeyPair;
 DLL_PUBLIC KeyPair * keypair_new();
 DLL_PUBLIC void keypair_delete(KeyPair * keypair);
 DLL_PUBLIC bool keypair_generate(KeyPair * keypair);
+DLL_PUBLIC EC_GROUP const * keypair_get_group(void);
 DLL_PUBLIC void keypair_export(KeyPair * keypair, char const * key_public, char const * key_private);
 DLL_PUBLIC bool keypair_import(KeyPair * keypair, char const * key_public, char const * key_private);
 DLL_PUBLIC void keypair_clear_keys(KeyPair * keypair);
@@ -42,7 +42,26 @@
 #include <pico/dllpublic.h>
 
 // Defines
-#define LOG(level_, ...) libpico_log_priority(level_, __VA_ARGS__);
+
+// Logging is gated on a cached threshold before calling into the library,
+// so that messages below the current level cost a single compare-and-branch
+// at the call site rather than a varargs call and a vsnprintf. Levels
+// follow syslog, so numerically higher values are less severe; the default
+// threshold of LOG_DEBUG lets everything through, matching the previous
+// unconditional behaviour
+#if defined(__GNUC__) || defined(__clang__)
+#define LOG(level_, ...) do { \
+		if (__builtin_expect((level_) <= libpico_log_threshold, 0)) { \
+			libpico_log_priority((level_), __VA_ARGS__); \
+		} \
+	} while (0)
+#else
+#define LOG(level_, ...) do { \
+		if ((level_) <= libpico_log_threshold) { \
+			libpico_log_priority((level_), __VA_ARGS__); \
+		} \
+	} while (0)
+#endif
 
 #if !defined(LOG_AUTHPRIV) && defined(LOG_AUTH)
 #define LOG_AUTHPRIV LOG_AUTH
@@ -79,9 +98,17 @@
 */
 typedef void (*LibPicoLogFunction) (int priority, const char* str, void* data);
 
+// The current log threshold, read by the LOG macro; use
+// libpico_set_log_level rather than writing to it directly
+DLL_PUBLIC extern int libpico_log_threshold;
+
 DLL_PUBLIC void libpico_set_log_function(LibPicoLogFunction logFunction, void* data);
+DLL_PUBLIC void libpico_set_log_level(int priority);
 
-void libpico_log_priority(int priority, const char* format, ...);
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((cold, format(printf, 2, 3)))
+#endif
+DLL_PUBLIC void libpico_log_priority(int priority, const char* format, ...);
 
 // Function definitions
 
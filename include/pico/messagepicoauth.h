@@ -38,6 +38,11 @@
  * The structure of the message is as follows
  * {"encryptedData":"B64-ENC","iv":"B64","sessionId":0}
  *
+ * The encryptedData field is encrypted with AES-128 in GCM mode through the
+ * one-pass EVP interface, with the 16-byte authentication tag appended to
+ * the ciphertext, so confidentiality and integrity are checked together
+ * during decryption and no separate HMAC is carried on the wire.
+ *
  */
 
 /** \addtogroup Message
@@ -41,6 +41,11 @@
  * Where encryptedData contains the following sections
  * char reauthState | length | char sequenceNumber[length] | length | char extraData[length]
  *
+ * The encryptedData field is encrypted with AES-128 in GCM mode through the
+ * one-pass EVP interface, with the 16-byte authentication tag appended to
+ * the ciphertext, so confidentiality and integrity are checked together
+ * during decryption and no separate HMAC is carried on the wire.
+ *
  */
 
 /** \addtogroup Message
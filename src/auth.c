@@ -58,12 +58,47 @@
 
 // Function definitions
 
+/**
+* Internal function checking whether a string can be dropped into a JSON
+* string value verbatim, that is, it contains no quotes, backslashes or
+* control characters that would need escaping.
+*
+* @param value The string to check
+* @return true if the string needs no JSON escaping, false o/w.
+*/
+static bool pair_json_verbatim(char const * value) {
+	size_t pos;
+
+	for (pos = 0; value[pos] != 0; pos++) {
+		if ((value[pos] == '"') || (value[pos] == '\\') || (((unsigned char)value[pos]) < 0x20)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 /**
 * Basically the same function as pair_loop, but the data sent to the phone is sent in a Json string as:
 * {"data": extraData, "name": username}
 * Newer version of the App will be able to save extraData and use username as the pairing name
 */
 bool pair_send_username_loop(Shared * shared, char const * servicename, char const * extraData, char const * username, Buffer * returnedStoredData, QrCallbackFunction qrCallback, void * data, int loop_verifier) {
+	char stackjson[512];
+	int written;
+
+	// The payload is a fixed two-field object, so when neither value
+	// needs escaping (the usual case for names and addresses) it can be
+	// formatted straight onto the stack, skipping the Json object and
+	// Buffer allocations; anything needing escapes or more space takes
+	// the general path below
+	if (pair_json_verbatim(extraData) && pair_json_verbatim(username)) {
+		written = snprintf(stackjson, sizeof(stackjson), "{\"name\":\"%s\",\"data\":\"%s\"}", username, extraData);
+		if ((written > 0) && (written < (int)sizeof(stackjson))) {
+			return pair_loop(shared, servicename, stackjson, returnedStoredData, qrCallback, data, loop_verifier);
+		}
+	}
+
 	Json * extraDataJson = json_new();
 	Buffer * buffer = buffer_new(0);
 
@@ -71,9 +106,8 @@ bool pair_send_username_loop(Shared * shared, char const * servicename, char con
 	json_add_string(extraDataJson, "name", username);
 	
 	json_serialize_buffer(extraDataJson, buffer);
-	buffer_append(buffer, "", 1);
 
-	bool result = pair_loop(shared, servicename, buffer_get_buffer(buffer), returnedStoredData, qrCallback, data, loop_verifier);
+	bool result = pair_loop(shared, servicename, buffer_cstr(buffer), returnedStoredData, qrCallback, data, loop_verifier);
 
 	json_delete(extraDataJson);
 	buffer_delete(buffer);
@@ -116,6 +150,7 @@ bool pair_loop(Shared * shared, char const * servicename, char const * extraData
 	bool result;
 	size_t size;
 	char * qrtext;
+	char qrstack[1024];
 	Buffer * buffer;
 	KeyPairing * keypairing;
 	int i;
@@ -136,14 +171,24 @@ bool pair_loop(Shared * shared, char const * servicename, char const * extraData
 		keypairing = keypairing_new();
 		keypairing_set(keypairing, buffer, "", NULL, servicename, serviceIdentityKey);
 
+		// The serialized size is known up front, so the QR text goes on
+		// the stack when it fits (it usually does) and only falls back to
+		// the heap for unusually long service names or keys
 		size = keypairing_serialize_size(keypairing);
-		qrtext = MALLOC(size + 1);
+		if ((size + 1) <= sizeof(qrstack)) {
+			qrtext = qrstack;
+		}
+		else {
+			qrtext = MALLOC(size + 1);
+		}
 		keypairing_serialize(keypairing, qrtext, size + 1);
 		keypairing_delete(keypairing);
 
 		result = qrCallback(qrtext, data);
 		
-		FREE(qrtext);
+		if (qrtext != qrstack) {
+			FREE(qrtext);
+		}
 	}
 	
 	if (result) {
@@ -178,6 +223,7 @@ bool auth(Shared * shared, Users * authorizedUsers, Buffer * returnedStoredData,
 	bool result;
 	size_t size;
 	char * qrtext;
+	char qrstack[1024];
 	Buffer * buffer;
 	KeyAuth * keyauth;
 
@@ -197,13 +243,22 @@ bool auth(Shared * shared, Users * authorizedUsers, Buffer * returnedStoredData,
 		keyauth = keyauth_new();
 		keyauth_set(keyauth, buffer, "", NULL, serviceIdentityKey);
 
+		// As in pair_loop, use the stack for the QR text unless the
+		// serialized form is too large for it
 		size = keyauth_serialize_size(keyauth);
-		qrtext = MALLOC(size + 1);
+		if ((size + 1) <= sizeof(qrstack)) {
+			qrtext = qrstack;
+		}
+		else {
+			qrtext = MALLOC(size + 1);
+		}
 		keyauth_serialize(keyauth, qrtext, size + 1);
 		keyauth_delete(keyauth);
 
 		result = qrCallback(qrtext, data);
-		FREE(qrtext);
+		if (qrtext != qrstack) {
+			FREE(qrtext);
+		}
 	}
 	
 	if (result) {
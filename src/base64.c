@@ -43,6 +43,7 @@
 #include "pico/cdecode.h"
 #include "pico/buffer.h"
 #include "pico/log.h"
+#include "pico/base64simd.h"
 #include "pico/base64.h"
 
 // Defines
@@ -51,8 +52,54 @@
 
 // Function prototypes
 
+static size_t base64_decode_to_mem(char const * memin, size_t length, char * memout);
+static size_t base64_encode_to_mem(char const * memin, size_t length, char * memout);
+
 // Function definitions
 
+/**
+ * Internal function decoding base64 character data straight into a memory
+ * area, which must be large enough to hold base64_decode_size_max_inline()
+ * bytes for the given length. The block decoder sends the bulk of the input
+ * through the shared vector kernels where the CPU supports them, with its
+ * scalar state machine handling the remainder.
+ *
+ * @param memin The base64 character data to decode.
+ * @param length The length of the input in bytes.
+ * @param memout The area to write the decoded bytes to.
+ * @return The number of bytes written to the output.
+ */
+static size_t base64_decode_to_mem(char const * memin, size_t length, char * memout) {
+	base64_decodestate state_in;
+
+	base64_init_decodestate(& state_in);
+	return base64_decode_block(memin, length, memout, & state_in);
+}
+
+/**
+ * Internal function encoding bytes to base64 characters straight into a
+ * memory area, which must be large enough to hold
+ * base64_encode_size_max_inline() bytes for the given length. The block
+ * encoder sends the bulk of the input through the shared vector kernels
+ * where the CPU supports them, with its scalar state machine handling the
+ * remainder and the padding.
+ *
+ * @param memin The bytes to encode.
+ * @param length The length of the input in bytes.
+ * @param memout The area to write the base64 characters to.
+ * @return The number of characters written to the output.
+ */
+static size_t base64_encode_to_mem(char const * memin, size_t length, char * memout) {
+	base64_encodestate state_in;
+	size_t written;
+
+	base64_init_encodestate(& state_in);
+	written = base64_encode_block(memin, length, memout, & state_in);
+	written += base64_encode_blockend(memout + written, & state_in);
+
+	return written;
+}
+
 /**
  * Base64 encode a buffer of bytes and store the result in a buffer.
  *
@@ -60,15 +107,12 @@
  * @param bufferout Buffer to store the returned base64-encoded string.
  */
 void base64_encode_buffer(Buffer const * bufferin, Buffer * bufferout) {
-	base64_encodestate state_in;
 	size_t size;
 
-	size = base64_encode_size_max(buffer_get_pos(bufferin));
+	size = base64_encode_size_max_inline(buffer_get_pos(bufferin));
 	buffer_set_min_size(bufferout, size);
 
-	base64_init_encodestate(& state_in);
-	size = base64_encode_block(buffer_get_buffer(bufferin), buffer_get_pos(bufferin), buffer_get_buffer(bufferout), & state_in);
-	size += base64_encode_blockend(buffer_get_buffer(bufferout) + size, & state_in);
+	size = base64_encode_to_mem(buffer_get_buffer(bufferin), buffer_get_pos(bufferin), buffer_get_buffer(bufferout));
 	buffer_set_pos(bufferout, size);
 
 	//printf ("Allocated: %lu\nSuggested: %lu\nUsed: %lu\n", buffer_get_size(bufferout), base64_encode_size_max(buffer_get_pos(bufferin)), size);
@@ -82,17 +126,14 @@ void base64_encode_buffer(Buffer const * bufferin, Buffer * bufferout) {
  * @param bufferout Buffer to store the returned base64-encoded string.
  */
 void base64_encode_string(char const * stringin, Buffer * bufferout) {
-	base64_encodestate state_in;
 	size_t stringlen;
 	size_t size;
 
 	stringlen = strlen(stringin);
-	size = base64_encode_size_max(stringlen);
+	size = base64_encode_size_max_inline(stringlen);
 	buffer_set_min_size(bufferout, size);
 
-	base64_init_encodestate(& state_in);
-	size = base64_encode_block(stringin, stringlen, buffer_get_buffer(bufferout), & state_in);
-	size += base64_encode_blockend(buffer_get_buffer(bufferout) + size, & state_in);
+	size = base64_encode_to_mem(stringin, stringlen, buffer_get_buffer(bufferout));
 	buffer_set_pos(bufferout, size);
 
 	//printf ("Allocated: %lu\nSuggested: %lu\nUsed: %lu\n", buffer_get_size(bufferout), base64_encode_size_max(stringlen), size);
@@ -107,15 +148,12 @@ void base64_encode_string(char const * stringin, Buffer * bufferout) {
  * @param bufferout Buffer to store the returned base64-encoded string.
  */
 void base64_encode_mem(char const * memin, size_t length, Buffer * bufferout) {
-	base64_encodestate state_in;
 	size_t size;
 
-	size = base64_encode_size_max(length);
+	size = base64_encode_size_max_inline(length);
 	buffer_set_min_size(bufferout, size);
 
-	base64_init_encodestate(& state_in);
-	size = base64_encode_block(memin, length, buffer_get_buffer(bufferout), & state_in);
-	size += base64_encode_blockend(buffer_get_buffer(bufferout) + size, & state_in);
+	size = base64_encode_to_mem(memin, length, buffer_get_buffer(bufferout));
 	buffer_set_pos(bufferout, size);
 
 	//printf ("Allocated: %lu\nSuggested: %lu\nUsed: %lu\n", buffer_get_size(bufferout), base64_encode_size_max(length), size);
@@ -129,14 +167,12 @@ void base64_encode_mem(char const * memin, size_t length, Buffer * bufferout) {
  * @param bufferout Buffer to store the returned byte data.
  */
 void base64_decode_buffer(Buffer const * bufferin, Buffer * bufferout) {
-	base64_decodestate state_in;
 	size_t size;
 
-	size = base64_decode_size_max(buffer_get_pos(bufferin));
+	size = base64_decode_size_max_inline(buffer_get_pos(bufferin));
 	buffer_set_min_size(bufferout, size);
 
-	base64_init_decodestate(& state_in);
-	size = base64_decode_block(buffer_get_buffer(bufferin), buffer_get_pos(bufferin), buffer_get_buffer(bufferout), & state_in);
+	size = base64_decode_to_mem(buffer_get_buffer(bufferin), buffer_get_pos(bufferin), buffer_get_buffer(bufferout));
 	buffer_set_pos(bufferout, size);
 
 	//printf ("Allocated: %lu\nSuggested: %lu\nUsed: %lu\n", buffer_get_size(bufferout), base64_decode_size_max(buffer_get_pos(bufferin)), size);
@@ -150,16 +186,14 @@ void base64_decode_buffer(Buffer const * bufferin, Buffer * bufferout) {
  * @param bufferout Buffer to store the returned byte data.
  */
 void base64_decode_string(char const * stringin, Buffer * bufferout) {
-	base64_decodestate state_in;
 	size_t stringlen;
 	size_t size;
 
 	stringlen = strlen(stringin);
-	size = base64_decode_size_max(stringlen);
+	size = base64_decode_size_max_inline(stringlen);
 	buffer_set_min_size(bufferout, size);
 
-	base64_init_decodestate(& state_in);
-	size = base64_decode_block(stringin, stringlen, buffer_get_buffer(bufferout), & state_in);
+	size = base64_decode_to_mem(stringin, stringlen, buffer_get_buffer(bufferout));
 	buffer_set_pos(bufferout, size);
 
 	//printf ("Allocated: %lu\nSuggested: %lu\nUsed: %lu\n", buffer_get_size(bufferout), base64_decode_size_max(stringlen), size);
@@ -174,14 +208,26 @@ void base64_decode_string(char const * stringin, Buffer * bufferout) {
  * @param bufferout Buffer to store the returned byte data.
  */
 void base64_decode_mem(char const * memin, size_t length, Buffer * bufferout) {
-	base64_decodestate state_in;
 	size_t size;
+	char * stripped;
+	size_t strippedlength;
 
-	size = base64_decode_size_max(length);
+	size = base64_decode_size_max_inline(length);
 	buffer_set_min_size(bufferout, size);
 
-	base64_init_decodestate(& state_in);
-	size = base64_decode_block(memin, length, buffer_get_buffer(bufferout), & state_in);
+	if (base64simd_strip_whitespace_available()) {
+		// Compact out embedded whitespace first so the vectorised decode
+		// kernel sees clean input rather than bailing to the scalar loop at
+		// every newline; the extra 8 bytes allow for the compaction's
+		// full-lane stores
+		stripped = MALLOC(length + 8);
+		strippedlength = base64simd_strip_whitespace(memin, length, stripped);
+		size = base64_decode_to_mem(stripped, strippedlength, buffer_get_buffer(bufferout));
+		FREE(stripped);
+	}
+	else {
+		size = base64_decode_to_mem(memin, length, buffer_get_buffer(bufferout));
+	}
 	buffer_set_pos(bufferout, size);
 
 	//printf ("Allocated: %lu\nSuggested: %lu\nUsed: %lu\n", buffer_get_size(bufferout), base64_decode_size_max(length), size);
@@ -196,7 +242,7 @@ void base64_decode_mem(char const * memin, size_t length, Buffer * bufferout) {
  * @return Maximum space in bytes needed to store a base64-encoded data.
  */
 size_t base64_encode_size_max(size_t input) {
-	return ((int)((input + 2) / 3)) * 4;
+	return base64_encode_size_max_inline(input);
 }
 
 /**
@@ -207,7 +253,7 @@ size_t base64_encode_size_max(size_t input) {
  * @return Maximum space in bytes needed to store the decoded data.
  */
 size_t base64_decode_size_max(size_t input) {
-	return ((int)((input + 3) / 4)) * 3 + 1;
+	return base64_decode_size_max_inline(input);
 }
 
 /** @} addtogroup Datahandling */
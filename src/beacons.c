@@ -47,6 +47,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 //#include <malloc.h>
 #include "pico/debug.h"
 #include "pico/buffer.h"
@@ -102,30 +105,60 @@
 // Structure definitions
 
 /**
- * @brief Data assocated with a single device beacons are sent to
+ * @brief Number of device slots to allocate when the list first grows
  *
- * This data structure is used to keep track of all data required
- * in order to send beacons to a specific, individual device.
+ * The device list storage is grown geometrically; this is the initial
+ * capacity allocated when the first device is added.
  *
- * The data forms a single-direction linked list. In practice we only ever
- * want to cycle through the full list, so a single linked list is appropriate.
- * The list is created once when the details are loaded from file, then deleted
- * at the end, so management of the list requires minimal functionality.
+ */
+#define DEVICES_GROW_INITIAL (8)
+
+/**
+ * @brief Block size for the per-device commitment buffers
+ *
+ * A commitment is a SHA-256 hash of the device owner's public key, so 32
+ * bytes is the exact size stored for devices that have one.
+ *
+ */
+#define DEVICES_COMMITMENT_BLOCK (32)
+
+/**
+ * @brief Block size for the per-device comment buffers
+ *
+ * Comment lines attached to a device are rare and short, so the comment
+ * buffers are created with a small block size; a long comment simply grows
+ * its buffer in these increments.
+ *
+ */
+#define DEVICES_COMMENT_BLOCK (64)
+
+/**
+ * @brief Handle onto a single device beacons are sent to
+ *
+ * The device details themselves are stored as parallel arrays inside the
+ * Beacons structure, so that cycling through the full list for beaconing
+ * strides linearly through memory rather than chasing pointers. This handle
+ * identifies one entry in those arrays; the iterator and accessor functions
+ * in the public API operate on these handles.
+ *
+ * Handles remain valid until the list is next modified (adding a device may
+ * reallocate the storage), which matches how the list is used in practice:
+ * it is created once when the details are loaded from file, cycled through,
+ * then deleted at the end.
  */
 struct _BeaconDevice {
-	Buffer * comment;
-	Buffer * commitment;
-	char * device;
-	void * data;
-	BeaconDevice * next;
+	Beacons * owner;
+	unsigned int index;
 };
 
 /**
  * @brief Header for the device list
  *
- * This data structure acts as a header entry for the device list. It links
- * to the linked-list of devices that are used for sending Bluetooth beacons
- * out to.
+ * This data structure holds the list of devices that are used for sending
+ * Bluetooth beacons out to. The per-device fields are stored as parallel
+ * arrays (structure-of-arrays), each indexed by the device's position in
+ * the list, so that iterating over addresses or commitments is sequential
+ * and prefetch-friendly.
  *
  * This is the data structure an external entity needs to create and keep track
  * of if managing Bluetooth MAC addresses.
@@ -133,15 +166,22 @@ struct _BeaconDevice {
  */
 struct _Beacons {
 	Buffer * comment;
-	BeaconDevice * first;
+	char (* address)[DEVICES_MAC_LENGTH + 1];
+	Buffer ** commitment;
+	Buffer ** devicecomment;
+	void ** data;
+	BeaconDevice * handles;
 	unsigned int num;
+	unsigned int capacity;
 };
 
 // Function prototypes
 
 static char * beacons_find_end(char * start);
-static BeaconDevice * beacondevice_new();
-static void beacondevice_delete(BeaconDevice * beacondevice);
+#if defined(__SSE2__)
+static bool beacons_mac_valid_sse2(char const * text);
+#endif
+static BeaconDevice * beacons_append_device(Beacons * beacons);
 static void beacons_append_comment(Beacons * beacons, BeaconDevice * beacondevice, char const * comment);
 
 // Function definitions
@@ -156,7 +196,6 @@ Beacons * beacons_new() {
 
 	beacons = CALLOC(sizeof(Beacons), 1);
 	
-	beacons->first = NULL;
 	beacons->comment = buffer_new(0);
 	
 	return beacons;
@@ -168,17 +207,33 @@ Beacons * beacons_new() {
  * @param beacons The object to free.
  */
 void beacons_delete(Beacons * beacons) {
-	BeaconDevice * current;
-	BeaconDevice * next;
+	unsigned int index;
 
 	if (beacons) {
-		if (beacons->first) {
-			next = beacons->first;
-			while (next != NULL) {
-				current = next;
-				next = current->next;
-				beacondevice_delete(current);
+		for (index = 0; index < beacons->num; index++) {
+			if (beacons->commitment[index]) {
+				buffer_delete(beacons->commitment[index]);
+				beacons->commitment[index] = NULL;
+			}
+			if (beacons->devicecomment[index]) {
+				buffer_delete(beacons->devicecomment[index]);
+				beacons->devicecomment[index] = NULL;
 			}
+			// The data pointer is owned by the calling application
+			beacons->data[index] = NULL;
+		}
+
+		if (beacons->capacity > 0) {
+			FREE(beacons->address);
+			FREE(beacons->commitment);
+			FREE(beacons->devicecomment);
+			FREE(beacons->data);
+			FREE(beacons->handles);
+		}
+
+		if (beacons->comment) {
+			buffer_delete(beacons->comment);
+			beacons->comment = NULL;
 		}
 
 		FREE(beacons);
@@ -186,46 +241,48 @@ void beacons_delete(Beacons * beacons) {
 }
 
 /**
- * Create a new instance of the class.
+ * Append a fresh entry to the end of the device list, growing the parallel
+ * arrays geometrically if they're full. The new entry has a zeroed address,
+ * empty commitment and comment buffers, and no application data.
  *
- * @return The newly created object.
- */
-static BeaconDevice * beacondevice_new() {
-	BeaconDevice * beacondevice;
-
-	beacondevice = CALLOC(sizeof(BeaconDevice), 1);
-	
-	beacondevice->comment = buffer_new(0);
-	beacondevice->commitment = buffer_new(0);
-	beacondevice->device = CALLOC(sizeof(char), DEVICES_MAC_LENGTH + 1);
-	beacondevice->data = NULL;
-	beacondevice->next = NULL;
-	
-	return beacondevice;
-}
-
-/**
- * Delete an instance of the class, freeing up the memory allocated to it.
+ * Growing the arrays may move them in memory, which invalidates any handles
+ * obtained before the call.
  *
- * @param beacondevice The object to free.
+ * @param beacons The list to append the entry to.
+ * @return A handle onto the newly appended entry.
  */
-static void beacondevice_delete(BeaconDevice * beacondevice) {
-	if (beacondevice) {
-		if (beacondevice->data) {
-			//beaconsend_delete(beacondevice->beaconsend);
-			beacondevice->data = NULL;
-		}
-		if (beacondevice->comment) {
-			buffer_delete(beacondevice->comment);
-			beacondevice->comment = NULL;
+static BeaconDevice * beacons_append_device(Beacons * beacons) {
+	unsigned int newcapacity;
+	unsigned int index;
+
+	if (beacons->num == beacons->capacity) {
+		if (beacons->capacity > 0) {
+			newcapacity = beacons->capacity * 2;
 		}
-		if (beacondevice->commitment) {
-			buffer_delete(beacondevice->commitment);
-			beacondevice->commitment = NULL;
+		else {
+			newcapacity = DEVICES_GROW_INITIAL;
 		}
-
-		FREE(beacondevice);
+		beacons->address = REALLOC(beacons->address, sizeof(beacons->address[0]) * newcapacity);
+		beacons->commitment = REALLOC(beacons->commitment, sizeof(Buffer *) * newcapacity);
+		beacons->devicecomment = REALLOC(beacons->devicecomment, sizeof(Buffer *) * newcapacity);
+		beacons->data = REALLOC(beacons->data, sizeof(void *) * newcapacity);
+		beacons->handles = REALLOC(beacons->handles, sizeof(BeaconDevice) * newcapacity);
+		beacons->capacity = newcapacity;
 	}
+
+	index = beacons->num;
+	memset(beacons->address[index], 0, DEVICES_MAC_LENGTH + 1);
+	// Commitments are a fixed 32 bytes and most devices carry no comment,
+	// so small block sizes keep the per-device allocations to tens of
+	// bytes rather than the default 2 KB block each
+	beacons->commitment[index] = buffer_new(DEVICES_COMMITMENT_BLOCK);
+	beacons->devicecomment[index] = buffer_new(DEVICES_COMMENT_BLOCK);
+	beacons->data[index] = NULL;
+	beacons->handles[index].owner = beacons;
+	beacons->handles[index].index = index;
+	beacons->num++;
+
+	return & beacons->handles[index];
 }
 
 /**
@@ -238,7 +295,7 @@ static void beacondevice_delete(BeaconDevice * beacondevice) {
  */
 static void beacons_append_comment(Beacons * beacons, BeaconDevice * beacondevice, char const * comment) {
 	if (beacondevice) {
-		buffer_append_string(beacondevice->comment, comment);
+		buffer_append_string(beacons->devicecomment[beacondevice->index], comment);
 	}
 	else {
 		buffer_append_string(beacons->comment, comment);
@@ -283,8 +340,8 @@ unsigned int beacons_load_devices(Beacons * beacons, char const * filename, User
 	char * tokenstart;
 	char * tokenend;
 	bool more;
+	bool matched;
 	BeaconDevice * device;
-	BeaconDevice ** next;
 	bool result;
 	//char const * code;
 	int count;
@@ -300,8 +357,6 @@ unsigned int beacons_load_devices(Beacons * beacons, char const * filename, User
 
 	input = fopen(filename, "r");
 	if (input) {
-		next = & beacons->first;
-
 		more = true;
 		while (more) {
 			more = false;
@@ -312,21 +367,33 @@ unsigned int beacons_load_devices(Beacons * beacons, char const * filename, User
 			if (start != NULL) {
 				if ((readLine[0] != '#') && (readLine[0] != '\n')) {
 					// Not a comment
-					bytecount = 0;
-					end = start;
-					tokenstart = start;
-					for (count = 0; count < 6; count++) {
-						tokenend = beacons_find_end(tokenstart);
-						if (tokenend > tokenstart) {
-							end = tokenend;
-							if ((tokenstart[0] != '\0') && (tokenstart[0] != '\n')) {
-								tokenstart = tokenend + 1;
-								bytecount++;
+					matched = false;
+#if defined(__SSE2__)
+					// Classify the whole address in one go; fall back to the
+					// scalar tokenizer for anything irregular
+					matched = beacons_mac_valid_sse2(start);
+					if (matched) {
+						end = start + DEVICES_MAC_LENGTH;
+					}
+#endif
+					if (matched == false) {
+						bytecount = 0;
+						end = start;
+						tokenstart = start;
+						for (count = 0; count < 6; count++) {
+							tokenend = beacons_find_end(tokenstart);
+							if (tokenend > tokenstart) {
+								end = tokenend;
+								if ((tokenstart[0] != '\0') && (tokenstart[0] != '\n')) {
+									tokenstart = tokenend + 1;
+									bytecount++;
+								}
 							}
 						}
+						// Check the initial MAC address is correctly formatted as XX:XX:XX:XX:XX:XX
+						matched = (bytecount == DEVICES_MAC_BYTES) && ((end - start) == DEVICES_MAC_LENGTH);
 					}
-					// Check the initial MAC address is correctly formatted as XX:XX:XX:XX:XX:XX
-					if ((bytecount == DEVICES_MAC_BYTES) && ((end - start) == DEVICES_MAC_LENGTH)) {
+					if (matched) {
 						start = end + 1;
 
 						// Read in the commitment
@@ -355,27 +422,23 @@ unsigned int beacons_load_devices(Beacons * beacons, char const * filename, User
 						}
 
 						if (matches) {
-							device = beacondevice_new();
-							*next = device;
-							next = & device->next;
+							device = beacons_append_device(beacons);
 
 							// Correctly found, so transfer the MAC for use beaconing
-							strncpy(device->device, readLine, DEVICES_MAC_LENGTH);
+							strncpy(beacons->address[device->index], readLine, DEVICES_MAC_LENGTH);
 
 							// Initialise the device data
-							buffer_append_buffer(device->commitment, commitment);
+							buffer_append_buffer(beacons->commitment[device->index], commitment);
 
 							//device->beaconsend = beaconsend_new();
-							//result = beaconsend_set_device(device->beaconsend, device->device);
+							//result = beaconsend_set_device(device->beaconsend, beacons->address[device->index]);
 							result = true;
 							if (result == false) {
-								LOG(LOG_ERR, "Failed to set device: %s\n", device->device);
+								LOG(LOG_ERR, "Failed to set device: %s\n", beacons->address[device->index]);
 							}
 
 							//code = buffer_get_buffer(beacons->code);
 							//beaconsend_set_code(device->beaconsend, code);
-
-							beacons->num++;
 						}
 					}
 				}
@@ -396,10 +459,62 @@ unsigned int beacons_load_devices(Beacons * beacons, char const * filename, User
 	return beacons->num;
 }
 
+#if defined(__SSE2__)
+/**
+ * Check in a single pass whether a line starts with a correctly formatted
+ * MAC address XX:XX:XX:XX:XX:XX followed by a token delimiter (:, newline
+ * or a null byte). The first sixteen characters are classified together
+ * using SSE2 byte compares rather than walking the line a character at a
+ * time: the five separator colons must appear at exactly the expected
+ * positions and no terminator may appear early.
+ *
+ * This is a fast path only; a line that fails the check is handed to the
+ * scalar tokenizer, so the set of accepted lines is unchanged.
+ *
+ * The buffer the line sits in must be at least 18 characters long, which is
+ * always the case for lines read into readLine by beacons_load_devices().
+ *
+ * @param text The start of the line to check
+ * @return true if the line starts with a well-formed MAC address
+ */
+static bool beacons_mac_valid_sse2(char const * text) {
+	__m128i chunk;
+	int colonbits;
+	char last;
+	char delim;
+	bool result;
+
+	result = false;
+
+	chunk = _mm_loadu_si128((__m128i const *)text);
+	// Separator colons at positions 2, 5, 8, 11 and 14 and nowhere else
+	colonbits = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(':')));
+	if (colonbits == 0x4924) {
+		// No terminator within the first sixteen characters
+		colonbits = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+		colonbits |= _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_setzero_si128()));
+		if (colonbits == 0) {
+			// The final address character and the delimiter that follows it
+			last = text[DEVICES_MAC_LENGTH - 1];
+			delim = text[DEVICES_MAC_LENGTH];
+			result = (last != ':') && (last != '\n') && (last != '\0')
+				&& ((delim == ':') || (delim == '\n') || (delim == '\0'));
+		}
+	}
+
+	return result;
+}
+#endif
+
 /**
  * An internal function used to tokenize entries loaded from file. Essentially
  * this function will find the next occurrence of :, newline or a null byte.
  *
+ * The scan is delegated to strcspn, which stops at the terminating null
+ * byte of its own accord and which the C library dispatches to a
+ * vectorized implementation, so long tokens (the base64 commitments) are
+ * searched several bytes at a time rather than with a per-character loop.
+ *
  * @param start The position in the string to start from
  * @return The next instance of a tokenization character; so this will point to
  * one of :, \n or \0
@@ -409,41 +524,57 @@ static char * beacons_find_end(char * start) {
 
 	end = start;
 	if (end != NULL) {
-		while ((end[0] != ':') && (end[0] != '\n') && (end[0] != '\0')) {
-			end++;
-		}
+		end += strcspn(end, ":\n");
 	}
 
 	return end;
 }
 
 /**
- * Obtain the first entry in the linked list of Bluetooth device addresses to
+ * Obtain the first entry in the list of Bluetooth device addresses to
  * send beacons to.
  *
  * @param beacons The object to get the data from.
- * @return The first device in the linked list of devices.
+ * @return A handle onto the first device in the list, or NULL if the list
+ *         is empty.
  */
 BeaconDevice * beacons_get_first(Beacons * beacons) {
-	return beacons->first;
+	BeaconDevice * beacondevice;
+
+	beacondevice = NULL;
+	if (beacons->num > 0) {
+		beacondevice = & beacons->handles[0];
+	}
+
+	return beacondevice;
 }
 
 /**
- * Obtain the next entry in the linked list of Bluetooth device addresses to
+ * Obtain the next entry in the list of Bluetooth device addresses to
  * send beacons to.
  *
- * @param beacondevice The current object in the linked list.
- * @return The next device in the linked list of devices.
+ * @param beacondevice The current entry in the list.
+ * @return A handle onto the next device in the list, or NULL if the end of
+ *         the list has been reached.
  */
 BeaconDevice * beacons_get_next(BeaconDevice * beacondevice) {
-	return beacondevice->next;
+	BeaconDevice * next;
+	Beacons * beacons;
+
+	next = NULL;
+	beacons = beacondevice->owner;
+	if ((beacondevice->index + 1) < beacons->num) {
+		next = & beacons->handles[beacondevice->index + 1];
+	}
+
+	return next;
 }
 
 /**
- * Returns the total number of devices stored in the linked list.
+ * Returns the total number of devices stored in the list.
  *
  * @param beacons The object to get the data from.
- * @return The total number of entries in the linked list.
+ * @return The total number of entries in the list.
  */
 unsigned int beacons_get_device_num(Beacons * beacons) {
 	return beacons->num;
@@ -456,7 +587,7 @@ unsigned int beacons_get_device_num(Beacons * beacons) {
  * @return A string representing the Bluetooth MAC address. Should not be freed.
  */
 char const * beacons_get_address(BeaconDevice * beacondevice) {
-	return beacondevice->device;
+	return beacondevice->owner->address[beacondevice->index];
 }
 
 /**
@@ -471,7 +602,7 @@ char const * beacons_get_address(BeaconDevice * beacondevice) {
  * @return Pointer to the data stored with this device (possibly NULL).
  */
 void * beacons_get_data(BeaconDevice * beacondevice) {
-	return beacondevice->data;
+	return beacondevice->owner->data[beacondevice->index];
 }
 
 /**
@@ -488,7 +619,7 @@ void * beacons_get_data(BeaconDevice * beacondevice) {
  * @param beacondevice The object to set the data for.
  */
 void beacons_set_data(BeaconDevice * beacondevice, void * data) {
-	beacondevice->data = data;
+	beacondevice->owner->data[beacondevice->index] = data;
 }
 
 /**
@@ -512,13 +643,12 @@ void beacons_set_data(BeaconDevice * beacondevice, void * data) {
  *         list. 
  */
 BeaconDevice * beacons_add_device(Beacons * beacons, char const * address, Buffer const * commitment) {
-	BeaconDevice * current;
+	unsigned int index;
 	int compare;
 	BeaconDevice * found;
 	size_t length;
 	size_t currentlength;
 	bool result;
-	BeaconDevice * last;
 
 	if (commitment) {
 		length = buffer_get_pos(commitment);
@@ -527,58 +657,44 @@ BeaconDevice * beacons_add_device(Beacons * beacons, char const * address, Buffe
 		length = 0;
 	}
 
-	// Check for duplicates
+	// Check for duplicates; the addresses are stored contiguously, so this
+	// scan strides sequentially through memory
 	found = NULL;
-	current = beacons->first;
-	last = current;
-	while (current) {
+	for (index = 0; index < beacons->num; index++) {
 		// Compare address
-		compare = strncmp(current->device, address, DEVICES_MAC_LENGTH);
+		compare = strncmp(beacons->address[index], address, DEVICES_MAC_LENGTH);
 		if (compare == 0) {
 			if (length > 0) {
-				result = buffer_equals(commitment, current->commitment);
+				result = buffer_equals(commitment, beacons->commitment[index]);
 				if (result == true) {
-					found = current;
+					found = & beacons->handles[index];
 				}
 			}
 			else {
-				if (current->commitment != NULL) {
-					currentlength = buffer_get_pos(current->commitment);
+				if (beacons->commitment[index] != NULL) {
+					currentlength = buffer_get_pos(beacons->commitment[index]);
 					if (currentlength == 0) {
-						found = current;
+						found = & beacons->handles[index];
 					}
 				}
 				else {
-					found = current;
+					found = & beacons->handles[index];
 				}
 			}
 		}
-
-		last = current;
-		current = current->next;
 	}
 
 	// There was no match, so we should add it	
 	if (found == NULL) {
-		found = beacondevice_new();
+		found = beacons_append_device(beacons);
 
 		// Transfer the MAC for use beaconing
-		strncpy(found->device, address, DEVICES_MAC_LENGTH);
-		found->device[DEVICES_MAC_LENGTH] = 0;
+		strncpy(beacons->address[found->index], address, DEVICES_MAC_LENGTH);
 
 		// Initialise the device data
 		if (commitment) {
-			buffer_append_buffer(found->commitment, commitment);
-		}
-
-		if (last != NULL) {
-			last->next = found;
-		}
-		else {
-			beacons->first = found;
+			buffer_append_buffer(beacons->commitment[found->index], commitment);
 		}
-
-		beacons->num++;
 	}
 
 	return found;
@@ -612,57 +728,58 @@ BeaconDevice * beacons_add_device(Beacons * beacons, char const * address, Buffe
  */
 bool beacons_export_devices(Beacons const * beacons, char const * file) {
 	FILE * output;
-	BeaconDevice * current;
+	unsigned int index;
 	bool result;
 	size_t commentlength;
 	Buffer * commitmentBase64;
-	char const * comment;
-	char const * commitment;
+	Buffer * serialized;
 	size_t commitmentlength;
+	size_t written;
 
 	result = true;
 
 	output = fopen(file, "w");
 	if (output) {
+		// The whole file is assembled in memory first and written with a
+		// single fwrite, rather than two or three fprintf calls per device
+		serialized = buffer_new(0);
+		commitmentBase64 = buffer_new(0);
+
 		// Output the header comment if there is one
 		commentlength = buffer_get_pos(beacons->comment);
 		if (commentlength > 0) {
-			comment = buffer_get_buffer(beacons->comment);
-			fprintf(output, "%s", comment);
+			buffer_append_buffer(serialized, beacons->comment);
 		}
 
-		commitmentBase64 = buffer_new(0);
-
-		current = beacons->first;
-		while (current) {
+		for (index = 0; index < beacons->num; index++) {
 			// Output the main data
-			if (current->commitment) {
-				commitmentlength = buffer_get_pos(current->commitment);
+			if (beacons->commitment[index]) {
+				commitmentlength = buffer_get_pos(beacons->commitment[index]);
 			}
 			else {
 				commitmentlength = 0;
 			}
 
+			buffer_append_string(serialized, beacons->address[index]);
 			if (commitmentlength > 0) {
-				base64_encode_buffer(current->commitment, commitmentBase64);
-				commitment = buffer_get_buffer(commitmentBase64);
-				fprintf(output, "%s:%s\n", current->device, commitment);
-			}
-			else {
-				fprintf(output, "%s\n", current->device);
+				base64_encode_buffer(beacons->commitment[index], commitmentBase64);
+				buffer_append(serialized, ":", 1);
+				buffer_append_buffer(serialized, commitmentBase64);
 			}
+			buffer_append(serialized, "\n", 1);
 
 			// Output the proceeding comment if there is one
-			commentlength = buffer_get_pos(current->comment);
+			commentlength = buffer_get_pos(beacons->devicecomment[index]);
 			if (commentlength > 0) {
-				comment = buffer_get_buffer(current->comment);
-				fprintf(output, "%s", comment);
+				buffer_append_buffer(serialized, beacons->devicecomment[index]);
 			}
-
-			current = current->next;
 		}
 
+		written = fwrite(buffer_get_buffer(serialized), 1, buffer_get_pos(serialized), output);
+		result = (written == buffer_get_pos(serialized));
+
 		buffer_delete(commitmentBase64);
+		buffer_delete(serialized);
 
 		fclose(output);
 	}
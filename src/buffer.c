@@ -402,10 +402,20 @@ void buffer_log_base64(Buffer * buffer) {
  * @param buffer The buffer to clear
  */
 void buffer_clear(Buffer * buffer) {
+	// If only a single block is allocated there's nothing to free up, so
+	// keep the allocation and just reset the length; this keeps repeated
+	// clear-and-refill cycles (as used on the hot authentication paths)
+	// away from the allocator entirely
+	if ((buffer->buffer) && (buffer->buffer_size == buffer->block_size)) {
+		buffer->buffer_pos = 0;
+		buffer->buffer[0] = 0;
+		return;
+	}
+
 	if (buffer->buffer) {
 		FREE (buffer->buffer);
 	}
-		
+
 	buffer->buffer_pos = 0;
 	buffer->buffer_size = 0;
 	buffer->buffer = MALLOC(buffer->block_size + 1);
@@ -491,6 +501,26 @@ char * buffer_get_buffer(Buffer const * buffer) {
 	return buffer->buffer;
 }
 
+/**
+ * Returns the buffer data as a null-terminated C string. Every allocation
+ * the buffer makes reserves one spare byte past the stored data for a
+ * terminating zero, so this simply writes the terminator at the current
+ * end position and returns the raw memory; nothing is appended and no
+ * reallocation can occur. The pointer follows the same ownership rules as
+ * buffer_get_buffer(): it belongs to the buffer and is invalidated by any
+ * call that changes the buffer's contents or size.
+ *
+ * Note that if the data itself contains zero bytes, the string will appear
+ * to end at the first of them.
+ *
+ * @param buffer The buffer to get the data from
+ * @return The data stored in the buffer as a null-terminated string.
+ */
+char const * buffer_cstr(Buffer const * buffer) {
+	buffer->buffer[buffer->buffer_pos] = 0;
+	return buffer->buffer;
+}
+
 /**
  * Returns the current quantity of memory allocated to the buffer. This will
  * be a multiple of the block size.
@@ -0,0 +1,573 @@
+/** \ingroup Datahandling
+ * @file
+ * @author  David Llewellyn-Jones <David.Llewellyn-Jones@cl.cam.ac.uk>
+ * @version $(VERSION)
+ *
+ * @section LICENSE
+ *
+ * (C) Copyright Cambridge Authentication Ltd, 2017
+ *
+ * This file is part of libpico.
+ *
+ * Libpico is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Libpico is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with libpico. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ *
+ * @brief Runtime-dispatched vector kernels for base64 coding
+ * @section DESCRIPTION
+ *
+ * The single home of the vectorised base64 kernels, following Muła and
+ * Lemire, "Faster Base64 Encoding and Decoding using AVX2 Instructions".
+ * Both the high-level coders in base64.c and the libb64-derived block
+ * coders in cencode.c and cdecode.c dispatch through the entry points
+ * here, so each algorithm exists exactly once.
+ *
+ * The kernels carry per-function target attributes rather than relying on
+ * the compiler's global instruction-set flags, so they are compiled into
+ * every x86 build the project's build system produces, and the entry
+ * points select between them (or fall back to consuming nothing) based on
+ * a one-time runtime CPU capability check.
+ *
+ */
+
+/** \addtogroup Datahandling
+ *  @{
+ */
+
+#include <string.h>
+#include "pico/base64simd.h"
+
+// Defines
+
+// The kernels need the target attribute (so intrinsics can be used without
+// global ISA flags) and the x86 intrinsics themselves; elsewhere the entry
+// points compile to their scalar no-op fallbacks
+#if defined(__has_attribute) && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#if __has_attribute(target)
+#define BASE64SIMD_X86 (1)
+#endif
+#endif
+
+#if defined(BASE64SIMD_X86)
+#include <immintrin.h>
+
+#define BASE64SIMD_CPU_SSSE3 (1 << 0)
+#define BASE64SIMD_CPU_AVX2 (1 << 1)
+#define BASE64SIMD_CPU_BMI2 (1 << 2)
+#endif
+
+// Structure definitions
+
+// Function prototypes
+
+#if defined(BASE64SIMD_X86)
+static int base64simd_cpu_flags(void);
+static size_t base64simd_decode_avx2(char const * memin, size_t length, char * memout, size_t * produced);
+static size_t base64simd_decode_ssse3(char const * memin, size_t length, char * memout, size_t * produced);
+static size_t base64simd_encode_avx2(char const * memin, size_t length, char * memout, size_t * produced);
+static size_t base64simd_encode_ssse3(char const * memin, size_t length, char * memout, size_t * produced);
+static size_t base64simd_strip_whitespace_avx2(char const * memin, size_t length, char * memout);
+#endif
+
+// Function definitions
+
+#if defined(BASE64SIMD_X86)
+/**
+ * Determine which of the instruction sets the kernels use are available on
+ * the running CPU. The result is detected once and cached; the cache write
+ * is an idempotent int store, so a racing first call from two threads is
+ * benign.
+ *
+ * @return A bitmask of the BASE64SIMD_CPU_* flags supported.
+ */
+static int base64simd_cpu_flags(void) {
+	static int flags = -1;
+	int detected;
+
+	if (flags < 0) {
+		detected = 0;
+		if (__builtin_cpu_supports("ssse3")) {
+			detected |= BASE64SIMD_CPU_SSSE3;
+		}
+		if (__builtin_cpu_supports("avx2")) {
+			detected |= BASE64SIMD_CPU_AVX2;
+		}
+		if (__builtin_cpu_supports("bmi2")) {
+			detected |= BASE64SIMD_CPU_BMI2;
+		}
+		flags = detected;
+	}
+
+	return flags;
+}
+
+/**
+ * Decode as much of a block of base64 character data as possible using the
+ * 256-bit kernel, which turns 32 input characters into 24 output bytes per
+ * iteration: the character values are translated to their six-bit codes
+ * with nibble-indexed shuffles and rolled deltas, validated in the same
+ * step, and packed with a pair of multiply-accumulates followed by a lane
+ * shuffle.
+ *
+ * The kernel stops at the first 32-character chunk containing anything
+ * outside the plain base64 alphabet (whitespace, padding or garbage), or
+ * when fewer than 32 characters remain; the amount consumed is always a
+ * multiple of four characters, so the scalar decoder can pick up cleanly
+ * from where it left off. Exactly the produced number of output bytes is
+ * written.
+ *
+ * @param memin The base64 character data to decode.
+ * @param length The length of the input in bytes.
+ * @param memout The area to write the decoded bytes to.
+ * @param produced Returns the number of bytes written to the output.
+ * @return The number of input characters consumed.
+ */
+__attribute__((target("avx2")))
+static size_t base64simd_decode_avx2(char const * memin, size_t length, char * memout, size_t * produced) {
+	__m256i const lut_lo = _mm256_setr_epi8(
+		0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+		0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+		0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+		0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+	__m256i const lut_hi = _mm256_setr_epi8(
+		0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+		0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+		0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+		0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	__m256i const lut_roll = _mm256_setr_epi8(
+		0, 16, 19, 4, -65, -65, -71, -71,
+		0, 0, 0, 0, 0, 0, 0, 0,
+		0, 16, 19, 4, -65, -65, -71, -71,
+		0, 0, 0, 0, 0, 0, 0, 0);
+	__m256i const pack_bytes = _mm256_setr_epi8(
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	__m256i chunk;
+	__m256i hi_nibbles;
+	__m256i lo_nibbles;
+	__m256i lo;
+	__m256i hi;
+	__m256i roll;
+	__m256i merged;
+	size_t consumed;
+
+	consumed = 0;
+	*produced = 0;
+
+	while (length - consumed >= 32) {
+		chunk = _mm256_loadu_si256((__m256i const *)(memin + consumed));
+		hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(chunk, 4), _mm256_set1_epi8(0x0f));
+		lo_nibbles = _mm256_and_si256(chunk, _mm256_set1_epi8(0x0f));
+		lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+		hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+
+		if (_mm256_testz_si256(lo, hi) == 0) {
+			// Something other than a plain alphabet character; leave the
+			// rest of the input to the scalar decoder
+			break;
+		}
+
+		roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(0x2f)), hi_nibbles));
+		chunk = _mm256_add_epi8(chunk, roll);
+
+		// Fold the four six-bit codes of each quad into three bytes, then
+		// draw the twelve meaningful bytes of each lane together
+		merged = _mm256_maddubs_epi16(chunk, _mm256_set1_epi32(0x01400140));
+		merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+		merged = _mm256_shuffle_epi8(merged, pack_bytes);
+		merged = _mm256_permutevar8x32_epi32(merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+
+		_mm_storeu_si128((__m128i *)(memout + *produced), _mm256_castsi256_si128(merged));
+		_mm_storel_epi64((__m128i *)(memout + *produced + 16), _mm256_extracti128_si256(merged, 1));
+
+		consumed += 32;
+		*produced += 24;
+	}
+
+	return consumed;
+}
+
+/**
+ * Decode as much of a block of base64 character data as possible using the
+ * 128-bit kernel, which turns 16 input characters into 12 output bytes per
+ * iteration using the same nibble-indexed shuffle translation and
+ * multiply-accumulate packing as the 256-bit version, for CPUs that have
+ * SSSE3 but not AVX2.
+ *
+ * The kernel stops at the first 16-character chunk containing anything
+ * outside the plain base64 alphabet (whitespace, padding or garbage), or
+ * when fewer than 16 characters remain; the amount consumed is always a
+ * multiple of four characters, so the scalar decoder can pick up cleanly
+ * from where it left off. Exactly the produced number of output bytes is
+ * written.
+ *
+ * @param memin The base64 character data to decode.
+ * @param length The length of the input in bytes.
+ * @param memout The area to write the decoded bytes to.
+ * @param produced Returns the number of bytes written to the output.
+ * @return The number of input characters consumed.
+ */
+__attribute__((target("ssse3")))
+static size_t base64simd_decode_ssse3(char const * memin, size_t length, char * memout, size_t * produced) {
+	__m128i const lut_lo = _mm_setr_epi8(
+		0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+		0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+	__m128i const lut_hi = _mm_setr_epi8(
+		0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+		0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	__m128i const lut_roll = _mm_setr_epi8(
+		0, 16, 19, 4, -65, -65, -71, -71,
+		0, 0, 0, 0, 0, 0, 0, 0);
+	__m128i const pack_bytes = _mm_setr_epi8(
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	__m128i chunk;
+	__m128i hi_nibbles;
+	__m128i lo_nibbles;
+	__m128i lo;
+	__m128i hi;
+	__m128i roll;
+	__m128i merged;
+	size_t consumed;
+	int tail;
+
+	consumed = 0;
+	*produced = 0;
+
+	while (length - consumed >= 16) {
+		chunk = _mm_loadu_si128((__m128i const *)(memin + consumed));
+		hi_nibbles = _mm_and_si128(_mm_srli_epi32(chunk, 4), _mm_set1_epi8(0x0f));
+		lo_nibbles = _mm_and_si128(chunk, _mm_set1_epi8(0x0f));
+		lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+		hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xffff) {
+			// Something other than a plain alphabet character; leave the
+			// rest of the input to the scalar decoder
+			break;
+		}
+
+		roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(0x2f)), hi_nibbles));
+		chunk = _mm_add_epi8(chunk, roll);
+
+		// Fold the four six-bit codes of each quad into three bytes, then
+		// draw the twelve meaningful bytes together; the store is split so
+		// that only twelve bytes of output are touched
+		merged = _mm_maddubs_epi16(chunk, _mm_set1_epi32(0x01400140));
+		merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+		merged = _mm_shuffle_epi8(merged, pack_bytes);
+
+		_mm_storel_epi64((__m128i *)(memout + *produced), merged);
+		tail = _mm_cvtsi128_si32(_mm_srli_si128(merged, 8));
+		memcpy(memout + *produced + 8, & tail, 4);
+
+		consumed += 16;
+		*produced += 12;
+	}
+
+	return consumed;
+}
+
+/**
+ * Encode as much of a block of bytes as possible using the 256-bit kernel,
+ * the symmetric counterpart of base64simd_decode_avx2(), which turns 24
+ * input bytes into 32 base64 characters per iteration: each lane is
+ * shuffled so every 16-bit word holds the bytes of one six-bit code, the
+ * codes are extracted with a multiply-high and multiply-low pair, and the
+ * codes are translated to ASCII with a saturating-subtract indexed offset
+ * lookup.
+ *
+ * The amount consumed is always a multiple of three bytes, so the scalar
+ * encoder can pick up cleanly from where it left off, including emitting
+ * any final padding.
+ *
+ * @param memin The bytes to encode.
+ * @param length The length of the input in bytes.
+ * @param memout The area to write the base64 characters to.
+ * @param produced Returns the number of characters written to the output.
+ * @return The number of input bytes consumed.
+ */
+__attribute__((target("avx2")))
+static size_t base64simd_encode_avx2(char const * memin, size_t length, char * memout, size_t * produced) {
+	__m256i const pack_bytes = _mm256_setr_epi8(
+		1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+		1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+	__m256i const lut_offsets = _mm256_setr_epi8(
+		65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+		65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+	__m256i chunk;
+	__m256i indices;
+	__m256i offsets;
+	size_t consumed;
+
+	consumed = 0;
+	*produced = 0;
+
+	// Each iteration loads two 16-byte halves of which the low twelve
+	// bytes are used, so a full 32 bytes of input must remain for the
+	// loads to stay in bounds
+	while (length - consumed >= 32) {
+		chunk = _mm256_set_m128i(
+			_mm_loadu_si128((__m128i const *)(memin + consumed + 12)),
+			_mm_loadu_si128((__m128i const *)(memin + consumed)));
+		chunk = _mm256_shuffle_epi8(chunk, pack_bytes);
+
+		indices = _mm256_or_si256(
+			_mm256_mulhi_epu16(_mm256_and_si256(chunk, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040)),
+			_mm256_mullo_epi16(_mm256_and_si256(chunk, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010)));
+
+		offsets = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+		offsets = _mm256_sub_epi8(offsets, _mm256_cmpgt_epi8(indices, _mm256_set1_epi8(25)));
+
+		_mm256_storeu_si256((__m256i *)(memout + *produced), _mm256_add_epi8(indices, _mm256_shuffle_epi8(lut_offsets, offsets)));
+
+		consumed += 24;
+		*produced += 32;
+	}
+
+	return consumed;
+}
+
+/**
+ * Encode as much of a block of bytes as possible using the 128-bit kernel,
+ * the symmetric counterpart of base64simd_decode_ssse3(), which turns 12
+ * input bytes into 16 base64 characters per iteration using the same
+ * shuffle, multiply pair and offset lookup as the 256-bit version, for
+ * CPUs that have SSSE3 but not AVX2.
+ *
+ * The amount consumed is always a multiple of three bytes, so the scalar
+ * encoder can pick up cleanly from where it left off, including emitting
+ * any final padding.
+ *
+ * @param memin The bytes to encode.
+ * @param length The length of the input in bytes.
+ * @param memout The area to write the base64 characters to.
+ * @param produced Returns the number of characters written to the output.
+ * @return The number of input bytes consumed.
+ */
+__attribute__((target("ssse3")))
+static size_t base64simd_encode_ssse3(char const * memin, size_t length, char * memout, size_t * produced) {
+	__m128i const pack_bytes = _mm_setr_epi8(
+		1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+	__m128i const lut_offsets = _mm_setr_epi8(
+		65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+	__m128i chunk;
+	__m128i indices;
+	__m128i offsets;
+	size_t consumed;
+
+	consumed = 0;
+	*produced = 0;
+
+	// The 16-byte load uses only its low twelve bytes, so a full 16
+	// bytes of input must remain for the load to stay in bounds
+	while (length - consumed >= 16) {
+		chunk = _mm_loadu_si128((__m128i const *)(memin + consumed));
+		chunk = _mm_shuffle_epi8(chunk, pack_bytes);
+
+		indices = _mm_or_si128(
+			_mm_mulhi_epu16(_mm_and_si128(chunk, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040)),
+			_mm_mullo_epi16(_mm_and_si128(chunk, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010)));
+
+		offsets = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+		offsets = _mm_sub_epi8(offsets, _mm_cmpgt_epi8(indices, _mm_set1_epi8(25)));
+
+		_mm_storeu_si128((__m128i *)(memout + *produced), _mm_add_epi8(indices, _mm_shuffle_epi8(lut_offsets, offsets)));
+
+		consumed += 12;
+		*produced += 16;
+	}
+
+	return consumed;
+}
+
+/**
+ * Compact a block of base64 character data by removing embedded whitespace
+ * (newline, carriage return, space and tab), writing the surviving bytes
+ * contiguously to the output.
+ *
+ * The scalar decoder state machine skips whitespace anyway, but a stray
+ * newline in the middle of a block forces the vectorised decode kernels
+ * back to the scalar loop. Compacting first with a branch-free pass keeps
+ * the kernels on clean input: each 32-byte chunk is classified with byte
+ * compares, and any chunk containing whitespace is compacted eight bytes
+ * at a time with a BMI2 parallel bit extract.
+ *
+ * The output area must be at least 8 bytes longer than the input, since
+ * the compaction stores full 8-byte lanes; at most length bytes are
+ * meaningful.
+ *
+ * @param memin The character data to compact.
+ * @param length The length of the input in bytes.
+ * @param memout The area to write the compacted data to.
+ * @return The number of meaningful bytes written to the output.
+ */
+__attribute__((target("avx2,bmi2")))
+static size_t base64simd_strip_whitespace_avx2(char const * memin, size_t length, char * memout) {
+	size_t consumed;
+	size_t produced;
+	__m256i chunk;
+	__m256i whitespace;
+	unsigned int keepmask;
+	unsigned long long bytemask;
+	unsigned long long lane;
+	int half;
+	char value;
+
+	consumed = 0;
+	produced = 0;
+
+	while (length - consumed >= 32) {
+		chunk = _mm256_loadu_si256((__m256i const *)(memin + consumed));
+		whitespace = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'));
+		whitespace = _mm256_or_si256(whitespace, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r')));
+		whitespace = _mm256_or_si256(whitespace, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')));
+		whitespace = _mm256_or_si256(whitespace, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t')));
+		keepmask = ~ (unsigned int)_mm256_movemask_epi8(whitespace);
+
+		if (keepmask == 0xffffffffu) {
+			// Nothing to strip from this chunk
+			memcpy(memout + produced, memin + consumed, 32);
+			produced += 32;
+		}
+		else {
+			for (half = 0; half < 4; half++) {
+				memcpy(& lane, memin + consumed + (half * 8), 8);
+				bytemask = _pdep_u64((keepmask >> (half * 8)) & 0xff, 0x0101010101010101ull) * 0xff;
+				lane = _pext_u64(lane, bytemask);
+				memcpy(memout + produced, & lane, 8);
+				produced += ((size_t)__builtin_popcountll(bytemask)) / 8;
+			}
+		}
+
+		consumed += 32;
+	}
+
+	while (consumed < length) {
+		value = memin[consumed];
+		if ((value != '\n') && (value != '\r') && (value != ' ') && (value != '\t')) {
+			memout[produced] = value;
+			produced++;
+		}
+		consumed++;
+	}
+
+	return produced;
+}
+#endif
+
+/**
+ * Decode as much of a block of base64 character data as possible with the
+ * best vector kernel the running CPU supports, writing exactly the
+ * produced number of bytes to the output. On builds or CPUs without a
+ * suitable instruction set nothing is consumed; the caller's scalar
+ * decoder handles whatever remains either way, so this can be called
+ * unconditionally. The amount consumed is always a multiple of four
+ * characters.
+ *
+ * @param memin The base64 character data to decode.
+ * @param length The length of the input in bytes.
+ * @param memout The area to write the decoded bytes to.
+ * @param produced Returns the number of bytes written to the output.
+ * @return The number of input characters consumed.
+ */
+size_t base64simd_decode(char const * memin, size_t length, char * memout, size_t * produced) {
+#if defined(BASE64SIMD_X86)
+	int flags;
+
+	flags = base64simd_cpu_flags();
+	if ((flags & BASE64SIMD_CPU_AVX2) != 0) {
+		return base64simd_decode_avx2(memin, length, memout, produced);
+	}
+	if ((flags & BASE64SIMD_CPU_SSSE3) != 0) {
+		return base64simd_decode_ssse3(memin, length, memout, produced);
+	}
+#endif
+	*produced = 0;
+	return 0;
+}
+
+/**
+ * Encode as much of a block of bytes as possible with the best vector
+ * kernel the running CPU supports, writing exactly the produced number of
+ * characters to the output. On builds or CPUs without a suitable
+ * instruction set nothing is consumed; the caller's scalar encoder handles
+ * whatever remains either way, including any final padding, so this can be
+ * called unconditionally. The amount consumed is always a multiple of
+ * three bytes.
+ *
+ * @param memin The bytes to encode.
+ * @param length The length of the input in bytes.
+ * @param memout The area to write the base64 characters to.
+ * @param produced Returns the number of characters written to the output.
+ * @return The number of input bytes consumed.
+ */
+size_t base64simd_encode(char const * memin, size_t length, char * memout, size_t * produced) {
+#if defined(BASE64SIMD_X86)
+	int flags;
+
+	flags = base64simd_cpu_flags();
+	if ((flags & BASE64SIMD_CPU_AVX2) != 0) {
+		return base64simd_encode_avx2(memin, length, memout, produced);
+	}
+	if ((flags & BASE64SIMD_CPU_SSSE3) != 0) {
+		return base64simd_encode_ssse3(memin, length, memout, produced);
+	}
+#endif
+	*produced = 0;
+	return 0;
+}
+
+/**
+ * Report whether base64simd_strip_whitespace() has a vector implementation
+ * on the running CPU. When this returns false the caller should skip the
+ * separate compaction pass: the scalar decoder skips whitespace as it
+ * goes, so compaction is only worthwhile as a cheap vector preamble.
+ *
+ * @return true if the whitespace compaction kernel can run, false o/w.
+ */
+bool base64simd_strip_whitespace_available(void) {
+#if defined(BASE64SIMD_X86)
+	int flags;
+
+	flags = base64simd_cpu_flags();
+	return ((flags & BASE64SIMD_CPU_AVX2) != 0) && ((flags & BASE64SIMD_CPU_BMI2) != 0);
+#else
+	return false;
+#endif
+}
+
+/**
+ * Compact a block of base64 character data by removing embedded whitespace
+ * (newline, carriage return, space and tab). Only valid to call when
+ * base64simd_strip_whitespace_available() returns true. The output area
+ * must be at least 8 bytes longer than the input; at most length bytes of
+ * it are meaningful.
+ *
+ * @param memin The character data to compact.
+ * @param length The length of the input in bytes.
+ * @param memout The area to write the compacted data to.
+ * @return The number of meaningful bytes written to the output.
+ */
+size_t base64simd_strip_whitespace(char const * memin, size_t length, char * memout) {
+#if defined(BASE64SIMD_X86)
+	return base64simd_strip_whitespace_avx2(memin, length, memout);
+#else
+	(void)memin;
+	(void)length;
+	(void)memout;
+	return 0;
+#endif
+}
+
+/** @} addtogroup Datahandling */
@@ -32,6 +32,7 @@
 #include "pico/debug.h"
 #include "pico/log.h"
 #include "pico/cdecode.h"
+#include "pico/base64simd.h"
 
 // Defines
 
@@ -73,7 +74,21 @@ int base64_decode_block(const char* code_in, const int length_in, char* plaintex
 	signed char fragment;
 	
 	*plainchar = state_in->plainchar;
-	
+
+	// Fast path: bulk-decode whole chunks with the shared vector kernels
+	// before dropping into the scalar state machine for the tail and any
+	// padding; on CPUs without a suitable instruction set the kernels
+	// consume nothing and the state machine handles everything
+	if (state_in->step == step_a)
+	{
+		size_t consumed;
+		size_t produced;
+		consumed = base64simd_decode(codechar, (size_t)length_in, plainchar, & produced);
+		codechar += consumed;
+		plainchar += produced;
+		*plainchar = 0;
+	}
+
 	switch (state_in->step)
 	{
 		while (1)
@@ -30,6 +30,7 @@
 #include "pico/debug.h"
 #include "pico/log.h"
 #include "pico/cencode.h"
+#include "pico/base64simd.h"
 
 // Defines
 
@@ -73,7 +74,20 @@ int base64_encode_block(const char* plaintext_in, int length_in, char* code_out,
 	char fragment;
 	
 	result = state_in->result;
-	
+
+	// Fast path: bulk-encode whole chunks with the shared vector kernels
+	// before dropping into the scalar state machine for the tail; on CPUs
+	// without a suitable instruction set the kernels consume nothing and
+	// the state machine handles everything
+	if (state_in->step == step_A)
+	{
+		size_t consumed;
+		size_t produced;
+		consumed = base64simd_encode(plainchar, (size_t)length_in, codechar, & produced);
+		plainchar += consumed;
+		codechar += produced;
+	}
+
 	switch (state_in->step)
 	{
 		while (1)
@@ -90,6 +90,11 @@ struct _RVPChannel {
 	ChannelSetUrl set_url;
 	ChannelSocketNeeded socket_needed;
 	ChannelSetTimeout set_timeout;
+
+	// Scratch for the length-framed copy made by channel_write_buffer();
+	// created on first use and kept for the lifetime of the channel so
+	// each message written doesn't pay an allocation
+	Buffer * prefixed;
 };
 
 // Function prototypes
@@ -113,9 +118,8 @@ RVPChannel * channel_connect(const char * name) {
 	channel_set_rvp(channel);
 
 	nameLen = strlen(name);
-	channel->name = CALLOC(sizeof(char), nameLen + 1);
-	strncpy(channel->name, name, nameLen);
-	channel->name[nameLen] = '\0';
+	channel->name = MALLOC(nameLen + 1);
+	memcpy(channel->name, name, nameLen + 1);
 
 	return channel;
 }
@@ -166,6 +170,9 @@ void channel_delete(RVPChannel * channel) {
 		if (channel->name) {
 			FREE (channel->name);
 		}
+		if (channel->prefixed) {
+			buffer_delete(channel->prefixed);
+		}
 		FREE (channel);
 	}
 }
@@ -435,7 +442,12 @@ bool channel_write_buffer(RVPChannel * channel, Buffer * buffer) {
 	bool result;
 
 	length = buffer_get_pos(buffer);
-	prefixed = buffer_new(length + 4);
+	if (channel->prefixed == NULL) {
+		channel->prefixed = buffer_new(length + 4);
+	}
+	prefixed = channel->prefixed;
+	buffer_clear(prefixed);
+	buffer_set_min_size(prefixed, length + 4);
 	data = buffer_get_buffer(prefixed);
 	data[0] = ((length >> 24) & 0xff);
 	data[1] = ((length >> 16) & 0xff);
@@ -445,7 +457,7 @@ bool channel_write_buffer(RVPChannel * channel, Buffer * buffer) {
 	buffer_append_buffer(prefixed, buffer);
 	length += 4;
 
-	result = channel_write(channel, data, length);
+	result = channel_write(channel, buffer_get_buffer(prefixed), length);
 	
 	return result;
 }
@@ -473,8 +485,7 @@ void channel_set_name(RVPChannel * channel, char const * name) {
 
 	nameLen = strlen(name);
 	channel->name = REALLOC(channel->name, nameLen + 1);
-	strncpy(channel->name, name, nameLen);
-	channel->name[nameLen] = '\0';
+	memcpy(channel->name, name, nameLen + 1);
 }
 
 /**
@@ -52,7 +52,6 @@
 
 // Defines
 
-#define CHANNEL_BT_PORT_STRING_MAXSIZE (3)
 #define PICO_SERVICE_UUID "00000000-0000-0000-0000-9C2A70314900"
 #define INVALID_SOCKET -1
 #define BLUETOOTH_PREFIX "btspp://"
@@ -83,20 +82,26 @@ void channel_get_url_bt(RVPChannel * channel, Buffer * buffer);
 bool channel_socket_needed_bt(RVPChannel * channel, int socket);
 void channel_set_timeout_bt(RVPChannel * channel, int timeout);
 bool channel_set_url_bt(RVPChannel * channel, char const * url);
+static bool channel_init_bt(RVPChannel * channel, bool use_port, unsigned char port);
 
 // Function definitions
 
 /**
- * Set a channel to use Bluetooth.
- * This overloads the required functions, sets the Bluetooth data object
- * and initialises the Bluetooth listening channel.
- *
- * In case of failure, the channel is unusable and has to be set again
+ * Internal function performing the initialisation sequence shared by the
+ * channel_set_bt*() entry points: allocate the context data, check Bluetooth
+ * is present, bind and listen on the listening socket, read the local device
+ * name and install the overloaded virtual functions. On any failure the
+ * partially initialised data is released and the channel's overloads are
+ * cleared, leaving the channel unusable until it is set again.
  *
  * @param channel The channel to set to Bluetooth.
+ * @param use_port True to bind to the specific port given, false to let the
+ *        Bluetooth stack pick one.
+ * @param port The port (RFCOMM channel) to bind to; ignored unless use_port
+ *        is true.
  * @return true if the Bluetooth was set up successfully, false o/w
  */
-bool channel_set_bt(RVPChannel * channel) {
+static bool channel_init_bt(RVPChannel * channel, bool use_port, unsigned char port) {
 	BTChannel * data;
 	bt_err_t bterror;
 
@@ -108,10 +113,15 @@ bool channel_set_bt(RVPChannel * channel) {
 	//bterror = bt_init();
 	bterror = bt_is_present();
 	//printf("BTError: %d\n", bterror);
-	
+
 	// Bind the listening socket
 	if (bterror == BT_SUCCESS) {
-		bterror = bt_bind(& data->listener);
+		if (use_port) {
+			bterror = bt_bind_to_channel(& data->listener, port);
+		}
+		else {
+			bterror = bt_bind(& data->listener);
+		}
 		if (bterror != BT_SUCCESS) {
 			LOG(LOG_ERR, "Failed to bind Bluetooth socket");
 		}
@@ -125,7 +135,7 @@ bool channel_set_bt(RVPChannel * channel) {
 	}
 
 	if (bterror == BT_SUCCESS) {
-		bterror = bt_get_device_name(&data->deviceName);
+		bterror = bt_get_device_name(& data->deviceName);
 		if (bterror != BT_SUCCESS) {
 			LOG(LOG_ERR, "Failed to get Bluetooth device name");
 		}
@@ -141,7 +151,7 @@ bool channel_set_bt(RVPChannel * channel) {
 	}
 	else {
 		FREE(data);
-		
+
 		channel_set_data(channel, NULL);
 		channel_set_functions(channel, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
 		channel_set_socket_needed_functions(channel, NULL);
@@ -160,59 +170,22 @@ bool channel_set_bt(RVPChannel * channel) {
  * @param channel The channel to set to Bluetooth.
  * @return true if the Bluetooth was set up successfully, false o/w
  */
-bool channel_set_bt_with_port(RVPChannel * channel, unsigned char port) {
-	BTChannel * data;
-	bt_err_t bterror;
-
-	data = CALLOC(sizeof(BTChannel), 1);
-
-	// Initialising Bluetooth multiple times on Windows will cause problems
-	// so we have to leave this to the controlling application
-	// Initialise Bluetooth
-	//bterror = bt_init();
-	bterror = bt_is_present();
-	//printf("BTError: %d\n", bterror);
-
-	// Bind the listening socket
-	if (bterror == BT_SUCCESS) {
-		//bterror = bt_bind(& data->listener);
-		bterror = bt_bind_to_channel(& data->listener, port);
-		if (bterror != BT_SUCCESS) {
-			LOG(LOG_ERR, "Failed to bind Bluetooth socket");
-		}
-	}
-
-	if (bterror == BT_SUCCESS) {
-		bterror = bt_listen(& data->listener);
-		if (bterror != BT_SUCCESS) {
-			LOG(LOG_ERR, "Failed to listen on Bluetooth socket");
-		}
-	}
-
-	if (bterror == BT_SUCCESS) {
-		bterror = bt_get_device_name(& data->deviceName);
-		if (bterror!= BT_SUCCESS) {
-			LOG(LOG_ERR, "Failed to get Bluetooth device name");
-		}
-	}
-
-	if (bterror == BT_SUCCESS) {
-		// Set the Bluetooth context data
-		channel_set_data(channel, data);
-
-		// Set the overloaded virtual functions
-		channel_set_functions(channel, channel_delete_bt, channel_open_bt, channel_close_bt, channel_write_bt, channel_read_bt, channel_get_url_bt, channel_set_url_bt, channel_set_timeout_bt);
-		channel_set_socket_needed_functions(channel, channel_socket_needed_bt);
-	}
-	else {
-		FREE(data);
-		
-		channel_set_data(channel, NULL);
-		channel_set_functions(channel, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-		channel_set_socket_needed_functions(channel, NULL);
-	}
+bool channel_set_bt(RVPChannel * channel) {
+	return channel_init_bt(channel, false, 0);
+}
 
-	return (bterror == BT_SUCCESS);
+/**
+ * Set a channel to use Bluetooth.
+ * This overloads the required functions, sets the Bluetooth data object
+ * and initialises the Bluetooth listening channel.
+ *
+ * In case of failure, the channel is unusable and has to be set again
+ *
+ * @param channel The channel to set to Bluetooth.
+ * @return true if the Bluetooth was set up successfully, false o/w
+ */
+bool channel_set_bt_with_port(RVPChannel * channel, unsigned char port) {
+	return channel_init_bt(channel, true, port);
 }
 
 
@@ -396,21 +369,17 @@ void channel_get_url_bt(RVPChannel * channel, Buffer * buffer) {
 	BTChannel * btchannel = (BTChannel *)channel_get_data(channel);
 	char device[BT_ADDRESS_FORMAT_COMPACT_MAXSIZE];
 	uint8_t port;
-	char port_str[CHANNEL_BT_PORT_STRING_MAXSIZE];
 
 	bt_addr_to_str_compact(& btchannel->deviceName, device);
-	buffer_clear(buffer);
-	buffer_append_string(buffer, BLUETOOTH_PREFIX);
-	buffer_append_string(buffer, device);
 
 	// If no uuid was set, we are only using a port so the port has
 	// to go to the URI
 	if (!memcmp(&btchannel->service, "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00", 16)) {
-		buffer_append_string(buffer, ":");
-
 		port = bt_get_socket_channel(btchannel->listener);
-		snprintf(port_str, CHANNEL_BT_PORT_STRING_MAXSIZE, "%02X", port);
-		buffer_append_string(buffer, port_str);
+		buffer_sprintf(buffer, BLUETOOTH_PREFIX "%s:%02X", device, port);
+	}
+	else {
+		buffer_sprintf(buffer, BLUETOOTH_PREFIX "%s", device);
 	}
 }
 
@@ -51,7 +51,6 @@
 
 // Defines
 
-#define CHANNEL_BT_PORT_STRING_MAXSIZE (3)
 #define PICO_SERVICE_UUID "00000000-0000-0000-0000-9C2A70314900"
 #define INVALID_SOCKET -1
 #define BLUETOOTH_PREFIX "btspp://"
@@ -80,9 +79,35 @@ bool channel_read_btout(RVPChannel * channel, Buffer * buffer);
 void channel_get_url_btout(RVPChannel * channel, Buffer * buffer);
 bool channel_set_url_btout(RVPChannel * channel, char const * url);
 void channel_set_timeout_btout(RVPChannel * channel, int timeout);
+static unsigned int channel_hex_digit_btout(char character);
 
 // Function definitions
 
+/**
+ * Internal utility function returning the value of a hexadecimal digit.
+ * The character must already have been checked with isxdigit(); the result
+ * for any other character is meaningless.
+ *
+ * @param character The hexadecimal digit to convert ('0'-'9', 'a'-'f' or
+ *        'A'-'F').
+ * @return The value of the digit, from 0 to 15.
+ */
+static unsigned int channel_hex_digit_btout(char character) {
+	unsigned int value;
+
+	if ((character >= '0') && (character <= '9')) {
+		value = character - '0';
+	}
+	else if ((character >= 'a') && (character <= 'f')) {
+		value = character - 'a' + 10;
+	}
+	else {
+		value = character - 'A' + 10;
+	}
+
+	return value;
+}
+
 /**
  * Set a channel to use Bluetooth.
  * This overloads the required functions, sets the Bluetooth data object
@@ -250,7 +275,6 @@ bool channel_read_btout(RVPChannel * channel, Buffer * buffer) {
 		((char *)(& length))[2] = lengthWord[1];
 		((char *)(& length))[3] = lengthWord[0];
 
-		LOG(LOG_INFO, "Reading %d bytes\n", length);
 		if ((length > 0) && (length < (1024 * 5))) {
 			LOG(LOG_INFO, "Reading %d bytes\n", length);
 
@@ -283,16 +307,9 @@ bool channel_read_btout(RVPChannel * channel, Buffer * buffer) {
 void channel_get_url_btout(RVPChannel * channel, Buffer * buffer) {
 	BTChannelOut * btchannel = (BTChannelOut *)channel_get_data(channel);
 	char deviceStr[BT_ADDRESS_FORMAT_COMPACT_MAXSIZE];
-	char portStr[CHANNEL_BT_PORT_STRING_MAXSIZE];
 
 	bt_addr_to_str_compact(& btchannel->deviceName, deviceStr);
-	buffer_clear(buffer);
-	buffer_append_string(buffer, "btspp://");
-	buffer_append_string(buffer, deviceStr);
-	buffer_append_string(buffer, ":");
-
-	snprintf(portStr, CHANNEL_BT_PORT_STRING_MAXSIZE, "%02X", btchannel->port);
-	buffer_append_string(buffer, portStr);
+	buffer_sprintf(buffer, BLUETOOTH_PREFIX "%s:%02X", deviceStr, btchannel->port);
 }
 
 /**
@@ -449,23 +466,23 @@ bool channel_decode_url_btout(char const * url, Buffer * address, unsigned int *
 		if (read == 0) {
 			checked += 1;
 
-			if (result == true) {
-				read = sscanf(url + checked, "%02u", & port_read);
-				if (read == 1) {
-					if (url[checked + 1] == 0) {
-						checked += 1;
-					}
-					else {
-						if (url[checked + 2] == 0) {
-							checked += 2;
-						}
-					}
-				}
-				else {
-					LOG(LOG_INFO, "Bluetooth URL port doesn't satisfy format");
-					result = false;
+			// The port is one or two hexadecimal digits, matching the
+			// "%02X" format used by channel_get_url_btout
+			character = url[checked];
+			if (isxdigit(character)) {
+				port_read = channel_hex_digit_btout(character);
+				checked += 1;
+
+				character = url[checked];
+				if (isxdigit(character)) {
+					port_read = (port_read << 4) | channel_hex_digit_btout(character);
+					checked += 1;
 				}
 			}
+			else {
+				LOG(LOG_INFO, "Bluetooth URL port doesn't satisfy format");
+				result = false;
+			}
 		}
 		else {
 			port_read = 0;
@@ -40,7 +40,7 @@
 #include <stdlib.h>
 //#include <malloc.h>
 #include <string.h>
-#include <time.h>
+#include <pthread.h>
 #include <curl/curl.h>
 #include <openssl/rand.h>
 #include "pico/debug.h"
@@ -81,7 +81,7 @@
  */
 struct _RVPChannelData {
 	Buffer * server;
-	time_t time_started;
+	CURL * curl;
 };
 
 typedef struct _RVPChannelData RVPChannelData;
@@ -89,15 +89,37 @@ typedef struct _RVPChannelData RVPChannelData;
 // Function prototypes
 
 bool channel_delete_rvp(RVPChannel * channel);
-bool channel_read_rvp(RVPChannel * channel, Buffer * buffer);
-bool channel_write_rvp(RVPChannel * channel, char * data, int length);
-void channel_get_url_rvp(RVPChannel * channel, Buffer * buffer);
 bool channel_set_url_rvp(RVPChannel * channel, char const * url);
 void channel_set_name_random_rvp(RVPChannel * channel);
-int channel_xferinfofunction_rvp (void * clientp, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
-static char const * channel_find_slash_rvp(char const * start, char const * end);
-static void channel_reset_timeout_rvp(RVPChannel * channel);
-static time_t channel_get_time_started_rvp(RVPChannel * channel);
+static CURL * channel_acquire_curl_rvp(RVPChannel * channel);
+static void channel_set_transfer_url_rvp(RVPChannel * channel, CURL * curl);
+static void channel_share_init_rvp(void);
+static void channel_share_lock_rvp(CURL * handle, curl_lock_data data, curl_lock_access access, void * userptr);
+static void channel_share_unlock_rvp(CURL * handle, curl_lock_data data, void * userptr);
+
+// Static variables
+
+/**
+ * Process-wide curl share object holding the DNS cache common to all
+ * Rendezvous Point channels. Channels are typically all pointed at the same
+ * host, so sharing the cache means only the first channel in the process
+ * (per cache TTL) pays for name resolution; without it each channel's easy
+ * handle resolves the hostname independently. Created once on first use by
+ * channel_share_init_rvp() and kept for the lifetime of the process.
+ */
+static CURLSH * channel_share_rvp = NULL;
+
+/**
+ * Guard ensuring channel_share_init_rvp() runs exactly once, however many
+ * threads create channels concurrently.
+ */
+static pthread_once_t channel_share_once_rvp = PTHREAD_ONCE_INIT;
+
+/**
+ * Mutexes used by libcurl to serialise access to the shared data, one per
+ * lockable data type (see the curl_lock_data values in curl.h).
+ */
+static pthread_mutex_t channel_share_locks_rvp[CURL_LOCK_DATA_LAST];
 
 // Function definitions
 
@@ -111,6 +133,19 @@ static time_t channel_get_time_started_rvp(RVPChannel * channel);
  * @param channel The channel to set to Bluetooth.
  * @return true if the Bluetooth was set up successfully, false o/w
  */
+/**
+ * Create a new channel that communicates via the Pico Rendezvous Point.
+ * This is equivalent to channel_new() followed by channel_set_rvp(), but
+ * makes the choice of backend explicit at the call site, so code holding
+ * such a channel can also call the channel_*_rvp() operations directly
+ * without going through the function-pointer dispatch.
+ *
+ * @return The newly created channel, bound to the Rendezvous Point backend
+ */
+RVPChannel * channel_new_rvp() {
+	return channel_new();
+}
+
 bool channel_set_rvp(RVPChannel * channel) {
 	RVPChannelData * data;
 
@@ -118,7 +153,6 @@ bool channel_set_rvp(RVPChannel * channel) {
 
 	data->server = buffer_new(0);
 	buffer_append_string(data->server, RVP_URL);
-	data->time_started = time(NULL);
 
 	// Set the Bluetooth context data
 	channel_set_data(channel, data);
@@ -146,6 +180,10 @@ bool channel_delete_rvp(RVPChannel * channel) {
 		// Clear the data pointer
 		buffer_delete(rvpchannel->server);
 
+		if (rvpchannel->curl) {
+			curl_easy_cleanup(rvpchannel->curl);
+		}
+
 		FREE(rvpchannel);
 	}
 
@@ -159,21 +197,22 @@ bool channel_delete_rvp(RVPChannel * channel) {
  * @param channel The channel set a random name for.
  */
 void channel_set_name_random_rvp(RVPChannel * channel) {
+	static char const hexdigits[] = "0123456789abcdef";
 	int res;
 	int i;
 	unsigned char random_bytes[CHANNEL_NAME_BYTES];
-	char * name;
+	char name[CHANNEL_NAME_BYTES * 2 + 1];
 
-	res = RAND_bytes(random_bytes, CHANNEL_NAME_BYTES); 
+	res = RAND_bytes(random_bytes, CHANNEL_NAME_BYTES);
 
 	if (res) {
-		name = CALLOC(sizeof(char), CHANNEL_NAME_BYTES * 2 + 1);
 		for (i = 0; i < CHANNEL_NAME_BYTES; i++) {
-			sprintf(name + i * 2, "%02x", random_bytes[i]);
+			name[i * 2] = hexdigits[random_bytes[i] >> 4];
+			name[i * 2 + 1] = hexdigits[random_bytes[i] & 0x0f];
 		}
-		
+		name[CHANNEL_NAME_BYTES * 2] = 0;
+
 		channel_set_name(channel, name);
-		FREE(name);
 	}
 }
 
@@ -195,27 +234,19 @@ bool channel_read_rvp(RVPChannel * channel, Buffer * buffer) {
 	CURLcode res;
 	RVPBuffer * rvpbuffer;
 	bool result;
-	Buffer * url;
 
 	result = true;
-	curl = curl_easy_init();
+	curl = channel_acquire_curl_rvp(channel);
 
 	if (curl) {
-		url = buffer_new(0);
-		channel_get_url_rvp(channel, url);
-		curl_easy_setopt(curl, CURLOPT_URL, buffer_get_buffer(url));
-		buffer_delete(url);
+		channel_set_transfer_url_rvp(channel, curl);
 
 		rvpbuffer = rvpbuffer_new(buffer);
 		///curl_easy_setopt(curl, CURLOPT_POSTFIELDS, "name=daniel&project=curl");
 		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, rvpbuffer_write);
 		curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)rvpbuffer);
 
-		//curl_easy_setopt(curl, CURLOPT_TIMEOUT, 40);
-		channel_reset_timeout_rvp(channel);
-		curl_easy_setopt(curl, CURLOPT_XFERINFODATA, (void *)channel);
-		curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, channel_xferinfofunction_rvp);
-		curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0);
+		curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)channel_get_timeout(channel));
 
 		res = curl_easy_perform(curl);
 		if (res != CURLE_OK) {
@@ -223,8 +254,6 @@ bool channel_read_rvp(RVPChannel * channel, Buffer * buffer) {
 			result = false;
 		}
 		rvpbuffer_delete(rvpbuffer);
-		
-		curl_easy_cleanup(curl);
 	}
 	else {
 		result = false;
@@ -247,16 +276,12 @@ bool channel_write_rvp(RVPChannel * channel, char * data, int length) {
 	CURL * curl;
 	CURLcode res;
 	bool result;
-	Buffer * url;
 
 	result = true;
-	curl = curl_easy_init();
+	curl = channel_acquire_curl_rvp(channel);
 
 	if (curl) {
-		url = buffer_new(0);
-		channel_get_url_rvp(channel, url);
-		curl_easy_setopt(curl, CURLOPT_URL, buffer_get_buffer(url));
-		buffer_delete(url);
+		channel_set_transfer_url_rvp(channel, curl);
 
 		//curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
 		//curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)buffer);
@@ -266,19 +291,13 @@ bool channel_write_rvp(RVPChannel * channel, char * data, int length) {
 
 		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, log_data);
 
-		//curl_easy_setopt(curl, CURLOPT_TIMEOUT, 240);
-		channel_reset_timeout_rvp(channel);
-		curl_easy_setopt(curl, CURLOPT_XFERINFODATA, (void *)channel);
-		curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, channel_xferinfofunction_rvp);
-		curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0);
+		curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)channel_get_timeout(channel));
 
 		res = curl_easy_perform(curl);
 		if (res != CURLE_OK) {
 			LOG(LOG_ERR, "Error writing to Rendezvous channel: %s\n", curl_easy_strerror(res));
 			result = false;
 		}
-		
-		curl_easy_cleanup(curl);
 	}
 	else {
 		result = false;
@@ -303,6 +322,34 @@ void channel_get_url_rvp(RVPChannel * channel, Buffer * buffer) {
 	}
 }
 
+/**
+ * Internal utility function that sets CURLOPT_URL for a transfer to the
+ * channel's full URL. The URL is a short string with a known layout
+ * (server, "/channel/" delimiter, 32 character channel name), so it's
+ * formatted on the stack; libcurl takes its own copy of the string. Only an
+ * unusually long server address falls back to composing it in a heap Buffer.
+ *
+ * @param channel The channel the transfer is for.
+ * @param curl The curl easy handle to set the URL option on.
+ */
+static void channel_set_transfer_url_rvp(RVPChannel * channel, CURL * curl) {
+	RVPChannelData * rvpchannel = (RVPChannelData *)channel_get_data(channel);
+	char urlstack[256];
+	int written;
+	Buffer * url;
+
+	written = snprintf(urlstack, sizeof(urlstack), "%s" CHANNEL "/%s", buffer_get_buffer(rvpchannel->server), channel_get_name(channel));
+	if ((written > 0) && (written < (int)sizeof(urlstack))) {
+		curl_easy_setopt(curl, CURLOPT_URL, urlstack);
+	}
+	else {
+		url = buffer_new(0);
+		channel_get_url_rvp(channel, url);
+		curl_easy_setopt(curl, CURLOPT_URL, buffer_get_buffer(url));
+		buffer_delete(url);
+	}
+}
+
 /**
  * Set the full URL of the channel, including the transport.
  *
@@ -336,7 +383,7 @@ bool channel_set_url_rvp(RVPChannel * channel, char const * url) {
 	buffer_delete(address);
 	buffer_delete(name);
 
-	return false;
+	return result;
 }
 
 /**
@@ -381,13 +428,15 @@ bool channel_decode_url_rvp(char const * url, Buffer * address, Buffer * channel
 	bool result;
 	int checked;
 	int read;
-	char const * slash_ultimate;
-	char const * slash_penultimate;
 	size_t length;
 	char const * address_start;
 	char const * address_end;
 	char const * channel_start;
 	char const * channel_end;
+	char const * search;
+	char const * found;
+	char const * after;
+	char const * match;
 
 	// URL must be of the form:
 	// http://AAAAAAAAAAAAAAAA/channel/XXXXXXXXXXXXXXXX
@@ -405,6 +454,7 @@ bool channel_decode_url_rvp(char const * url, Buffer * address, Buffer * channel
 	address_end = url;
 	channel_start = url;
 	channel_end = url;
+	match = NULL;
 
 	if (url == NULL) {
 		LOG(LOG_INFO, "RVP URL is NULL");
@@ -439,34 +489,36 @@ bool channel_decode_url_rvp(char const * url, Buffer * address, Buffer * channel
 		if (url[length - 1] == '/') {
 			length--;
 		}
-		slash_ultimate = channel_find_slash_rvp(url + checked, url + length - checked);
-		if (slash_ultimate == NULL) {
-			// This is the URL prefix without a channel
-			checked = length;
-			address_end = url + length;
-		}
-		else {
-			read = strncmp(CHANNEL, slash_ultimate, url + length - slash_ultimate);
-			if (read == 0) {
-				address_end = slash_ultimate;
+		// Scan forwards for the "/channel" delimiter. An occurrence only
+		// counts as the delimiter if it sits at the very end of the URL (no
+		// channel identifier) or is followed by a single final path
+		// component (the channel identifier); anywhere else it is just part
+		// of the address. The rightmost qualifying occurrence wins
+		search = url + checked;
+		while ((found = strstr(search, CHANNEL)) != NULL) {
+			after = found + sizeof(CHANNEL) - 1;
+			if (after > url + length) {
+				break;
 			}
-			else {
-				slash_penultimate = channel_find_slash_rvp(url + checked, slash_ultimate - 1);
-				if (slash_penultimate == NULL) {
-					address_end = url + length;
-				}
-				else {
-					read = strncmp(CHANNEL, slash_penultimate, url + length - slash_ultimate);
-					if (read == 0) {
-						address_end = slash_penultimate;
-						channel_start = slash_ultimate + 1;
-						channel_end = url + length;
-					}
-					else {
-						address_end = url + length;
-					}
-				}
+			if (after == url + length) {
+				match = found;
+				channel_start = url + length;
+				channel_end = url + length;
+			}
+			else if ((*after == '/') && (memchr(after + 1, '/', url + length - (after + 1)) == NULL)) {
+				match = found;
+				channel_start = after + 1;
+				channel_end = url + length;
 			}
+			search = found + 1;
+		}
+
+		if (match != NULL) {
+			address_end = match;
+		}
+		else {
+			// This is the URL prefix without a channel
+			address_end = url + length;
 		}
 
 		if (address != NULL) {
@@ -487,104 +539,115 @@ bool channel_decode_url_rvp(char const * url, Buffer * address, Buffer * channel
 }
 
 /**
- * Internal callback function provided to libcurl that will timeout the
- * connection after a certain period of calendar (real-world) time. The time
- * out period is set in the RVPChannel structure, but the default is currently
- * 40s to match the default Rendezvous Point timeout.
- * See the libcurl documentation for more details about this callback:
- * https://curl.haxx.se/libcurl/c/CURLOPT_XFERINFOFUNCTION.html
- *
- * @param clientp Pointer to the user data passed by us to libcurl. This is
- *        expected to be the RVPChannel structure for the channel.
- * @param dlnow The number of bytes downloaded so far.
- * @param ultotal The total number of bytes libcurl expects to upload in this
- *        transfer.
- * @param ulnow The number of bytes uploaded so far.
- * @return 0 to continue, any other value causes libcurl to abort the transfer
- *         and return
+ * Internal utility function returning the channel's curl easy handle, ready
+ * for the next transfer. The handle is created on first use and kept on the
+ * channel until channel_delete(), rather than being created and destroyed
+ * around every transfer. Reusing the handle lets libcurl keep the TCP
+ * connection to the Rendezvous Point alive and reuse its cached DNS
+ * resolution across the several round-trips of a protocol run, so only the
+ * first operation on a channel pays the connection set-up cost.
+ *
+ * A handle carried over from a previous transfer is passed through
+ * curl_easy_reset() so that no options set by one operation (POST fields,
+ * write callbacks) leak into the next; the reset preserves the handle's live
+ * connections and DNS cache.
+ *
+ * @param channel The channel to get the easy handle for.
+ * @return The easy handle to use for the transfer, or NULL if libcurl could
+ *         not allocate one.
  */
-int channel_xferinfofunction_rvp (void * clientp, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
-	RVPChannel * channel = (RVPChannel *)clientp;
-	int result;
-	double open;
-	time_t now;
-	time_t started;
-	double timeout;
-
-	result = 0;
-	now = time(NULL);
-	started = channel_get_time_started_rvp(channel);
-	// difftime returns time in seconds, and channel->timeout is miliseconds
-	open = difftime(now, started) * 1000;
-
-	timeout = channel_get_timeout(channel);
-	if (open > timeout) {
-		// Cancel the transfer
-		result = 1;
+static CURL * channel_acquire_curl_rvp(RVPChannel * channel) {
+	RVPChannelData * rvpchannel = (RVPChannelData *)channel_get_data(channel);
+	CURL * curl;
+
+	curl = NULL;
+	if (rvpchannel) {
+		if (rvpchannel->curl == NULL) {
+			rvpchannel->curl = curl_easy_init();
+		}
+		else {
+			curl_easy_reset(rvpchannel->curl);
+		}
+		curl = rvpchannel->curl;
 	}
 
-	return result;
+	if (curl) {
+		// Attach the process-wide DNS cache; curl_easy_reset() clears the
+		// option, so this has to be re-applied for every transfer
+		pthread_once(&channel_share_once_rvp, channel_share_init_rvp);
+		if (channel_share_rvp) {
+			curl_easy_setopt(curl, CURLOPT_SHARE, channel_share_rvp);
+		}
+
+		// Messages are small and discrete, so send them immediately rather
+		// than letting Nagle's algorithm hold them back (explicit for older
+		// libcurl versions; the default since 7.50)
+		curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+
+		// The connection sits idle while waiting for the Pico's next
+		// message, so probe it with keepalives to stop NAT middleboxes
+		// silently dropping the mapping between round-trips
+		curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+		curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 30L);
+	}
+
+	return curl;
 }
 
 /**
- * Internal utility function that will find the next '/' character in a string,
- * starting from the end and working towards the front. If there is no such
- * character in the string, the function will return NULL.
- *
- * @param start The start of the string in memory.
- * @param end The end of the string in memory.
- * @return The location of the rightmost '/' character, or NULL if there is
- *         none.
+ * Internal function creating the process-wide curl share object through
+ * which all Rendezvous Point easy handles share one DNS cache and one TLS
+ * session cache. Called exactly once, via pthread_once(), from
+ * channel_acquire_curl_rvp().
+ *
+ * If curl_share_init() fails the share pointer stays NULL and each easy
+ * handle simply falls back to its own private caches, so no error is
+ * surfaced to the caller.
  */
-static char const * channel_find_slash_rvp(char const * start, char const * end) {
-	char const * pos;
-	
-	pos = end;
-	while ((pos > start) && (*pos != '/')) {
-		pos--;
-	}
+static void channel_share_init_rvp(void) {
+	int lock;
 
-	if ((start >= end) || (*pos != '/')) {
-		pos = NULL;
+	for (lock = 0; lock < CURL_LOCK_DATA_LAST; lock++) {
+		pthread_mutex_init(&channel_share_locks_rvp[lock], NULL);
 	}
 
-	return pos;
+	channel_share_rvp = curl_share_init();
+	if (channel_share_rvp) {
+		curl_share_setopt(channel_share_rvp, CURLSHOPT_LOCKFUNC, channel_share_lock_rvp);
+		curl_share_setopt(channel_share_rvp, CURLSHOPT_UNLOCKFUNC, channel_share_unlock_rvp);
+		curl_share_setopt(channel_share_rvp, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+		// Shared TLS session IDs let later channels to the same https
+		// rendezvous server resume the first channel's TLS session instead
+		// of running a full handshake
+		curl_share_setopt(channel_share_rvp, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+	}
 }
 
 /**
- * Reset the timeout on a channel. Once called, the channel should be
- * subsequently kept open for the standard length of time previously set
- * using channel_set_timeout().
- *
- * @param channel The channel to reset the timeout on.
+ * Internal callback function provided to libcurl for taking the lock
+ * protecting one of the shared data types. See the libcurl documentation:
+ * https://curl.haxx.se/libcurl/c/CURLSHOPT_LOCKFUNC.html
+ *
+ * @param handle The easy handle requesting the lock (unused).
+ * @param data Which shared data type the lock protects.
+ * @param access Whether shared or single access is wanted (unused; the
+ *        mutexes grant single access either way).
+ * @param userptr Pointer to the user data passed by us to libcurl (unused).
  */
-static void channel_reset_timeout_rvp(RVPChannel * channel) {
-	RVPChannelData * rvpchannel = (RVPChannelData *)channel_get_data(channel);
-
-	if (rvpchannel) {
-		rvpchannel->time_started = time(NULL);
-	}
+static void channel_share_lock_rvp(CURL * handle, curl_lock_data data, curl_lock_access access, void * userptr) {
+	pthread_mutex_lock(&channel_share_locks_rvp[data]);
 }
 
 /**
- * Get the time when the channel was opened. This can be used to determine
- * whether a timeout should be triggered,
+ * Internal callback function provided to libcurl for releasing the lock
+ * taken by channel_share_lock_rvp().
  *
- * @param channel The channel to get the time started info for.
- * @return the time the channel was opoened.
+ * @param handle The easy handle releasing the lock (unused).
+ * @param data Which shared data type the lock protects.
+ * @param userptr Pointer to the user data passed by us to libcurl (unused).
  */
-static time_t channel_get_time_started_rvp(RVPChannel * channel) {
-	RVPChannelData * rvpchannel = (RVPChannelData *)channel_get_data(channel);
-	time_t time_started;
-
-	if (rvpchannel) {
-		time_started = rvpchannel->time_started;
-	}
-	else {
-		time_started = 0;
-	}
-
-	return time_started;
+static void channel_share_unlock_rvp(CURL * handle, curl_lock_data data, void * userptr) {
+	pthread_mutex_unlock(&channel_share_locks_rvp[data]);
 }
 
 
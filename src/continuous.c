@@ -113,13 +113,6 @@ static REAUTHSTATE continuous_transition(REAUTHSTATE oldState, REAUTHSTATE newSt
 
 	switch (oldState) {
 		case REAUTHSTATE_CONTINUE:
-			if (newState == REAUTHSTATE_CONTINUE || newState == REAUTHSTATE_PAUSE || newState == REAUTHSTATE_STOP) {
-				ret = newState;
-			} else {
-				LOG(LOG_ERR, "Invalid transition: %d %d\n", oldState, newState);
-				ret = REAUTHSTATE_ERROR;
-			}
-			break;
 		case REAUTHSTATE_PAUSE:
 			if (newState == REAUTHSTATE_CONTINUE || newState == REAUTHSTATE_PAUSE || newState == REAUTHSTATE_STOP) {
 				ret = newState;
@@ -517,7 +510,6 @@ bool continuous_read_pico_reauth(Continuous * continuous, SequenceNumber * seque
 	// RECEIVE
 	// Read PicoReAuthMessage from client
 	// {"encryptedData":"B64-ENC","iv":"B64","sessionId":0}
-	buffer_clear(buffer);
 	result = channel_read(continuous->channel, buffer);
 	LOG(LOG_INFO, "PicoReauth received\n");
 
@@ -637,7 +629,6 @@ bool continuous_read_service_reauth(Continuous * continuous, SequenceNumber * se
 	// {"encryptedData":"B64-ENC","iv":"B64","sessionId":0}
 	// Where encryptedData contains the following sections
 	// char reauthState | int timeout | length | char sequenceNumber[length]
-	buffer_clear(buffer);
 	channel_set_timeout(continuous->channel, continuous->currentTimeout + continuous->timeoutLeeway);
 	result = channel_read(continuous->channel, buffer);
 	LOG(LOG_INFO, "ServiceReauth received\n");
@@ -49,18 +49,229 @@
 #include "pico/debug.h"
 #include "pico/base64.h"
 #include "pico/log.h"
+#include "pico/keypair.h"
 #include "pico/cryptosupport.h"
 
 // Defines
 
 #define CRYPTOSUPPORT_TAG_LENGTH (16)
+// Stack space for DER-encoding keys; an EC public key or PKCS8 private key
+// for the curves used here is well under this, so the heap fallback in the
+// PEM/DER export functions is only taken for unusually large keys
+#define CRYPTOSUPPORT_DER_STACK_SIZE (256)
+
+/**
+ * @brief Number of parsed keys to cache per key type
+ *
+ * Long-lived identity keys are presented repeatedly, so the base64-decode
+ * and DER-parse cost of reading them can be amortised to a single parse.
+ * Four entries is enough to cover the keys in play with room to spare.
+ *
+ * The caches are per-thread, like the cipher and digest contexts below, so
+ * concurrent handshakes never contend on them. Ephemeral handshake keys are
+ * fresh every time and must not go through these caches: a guaranteed miss
+ * would only evict the long-lived entries, so the message deserializers
+ * parse them directly.
+ */
+#define CRYPTOSUPPORT_KEY_CACHE_SIZE (4)
 
 // Structure definitions
 
+/**
+ * @brief Cached cipher contexts for the encrypt and decrypt wrappers
+ *
+ * The continuous authentication heartbeat encrypts and decrypts one message
+ * per cycle with the same shared key throughout. Allocating a fresh
+ * EVP_CIPHER_CTX and running the full AES key schedule for every message
+ * costs more than the AES-NI work itself on short payloads, so each wrapper
+ * keeps a per-thread context and re-keys it only when the caller passes a
+ * different key; otherwise only the IV is re-initialised per call.
+ *
+ * The contexts live for the lifetime of the thread.
+ */
+static __thread EVP_CIPHER_CTX * cryptosupport_encrypt_ctx = NULL;
+static __thread unsigned char cryptosupport_encrypt_key[16];
+static __thread bool cryptosupport_encrypt_key_valid = false;
+
+static __thread EVP_CIPHER_CTX * cryptosupport_decrypt_ctx = NULL;
+static __thread unsigned char cryptosupport_decrypt_key[16];
+static __thread bool cryptosupport_decrypt_key_valid = false;
+
+/**
+ * @brief Cached HMAC context, reused across cryptosupport_generate_mac calls
+ *
+ * HMAC_Init_ex re-keys the context on every call, so a single context per
+ * thread is safe to reuse and avoids an allocation and init/cleanup cycle
+ * per MAC. The digest itself goes through EVP_sha256(), which OpenSSL's
+ * cpuid dispatch accelerates (SHA-NI where available); see
+ * cryptosupport_startup().
+ */
+static __thread HMAC_CTX * cryptosupport_hmac_ctx = NULL;
+
+/**
+ * @brief Cached digest contexts for signature verification and hashing
+ *
+ * Signature verification runs once per authentication message and hashing
+ * once per commitment, each allocating and freeing an EVP_MD_CTX around a
+ * short digest. Reusing a single context per thread avoids the
+ * allocation and method lookup per call. The verification context must
+ * be reset before each re-key: from OpenSSL 3.0 a repeated
+ * EVP_DigestVerifyInit on a live context can retain the previous key,
+ * which would make verification pass against the wrong public key.
+ *
+ * The contexts live for the lifetime of the thread.
+ */
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+#define EVP_MD_CTX_reset EVP_MD_CTX_cleanup
+#endif
+static __thread EVP_MD_CTX * cryptosupport_verify_mdctx = NULL;
+static __thread EVP_MD_CTX * cryptosupport_sha256_mdctx = NULL;
+
+/**
+ * @brief Cache entry mapping base64 key text onto its parsed form
+ *
+ * The base64 field holds the encoded text the caller supplied; the parsed
+ * key is handed out as a copy so the caller's ownership semantics (free
+ * when done) are unchanged. The lastused field supports least-recently-used
+ * eviction.
+ */
+typedef struct _KeyCacheEntry {
+	Buffer * base64;
+	EC_KEY * eckey;
+	EVP_PKEY * pkey;
+	unsigned int lastused;
+} KeyCacheEntry;
+
+static __thread KeyCacheEntry cryptosupport_public_key_cache[CRYPTOSUPPORT_KEY_CACHE_SIZE];
+static __thread KeyCacheEntry cryptosupport_private_key_cache[CRYPTOSUPPORT_KEY_CACHE_SIZE];
+static __thread unsigned int cryptosupport_key_cache_clock = 0;
+
 // Function prototypes
 
+static KeyCacheEntry * cryptosupport_key_cache_find(KeyCacheEntry * cache, char const * data, size_t length);
+static KeyCacheEntry * cryptosupport_key_cache_insert(KeyCacheEntry * cache, char const * data, size_t length);
+static EVP_PKEY * cryptosupport_dup_private_key(EVP_PKEY * pkey);
+
 // Function definitions
 
+/**
+ * Search a key cache for an entry whose base64 text matches the given data.
+ * A hit also refreshes the entry's LRU stamp.
+ *
+ * @param cache The cache to search
+ * @param data The base64 key text to look for
+ * @param length The length of the text in bytes
+ * @return The matching entry, or NULL if there's no match
+ */
+static KeyCacheEntry * cryptosupport_key_cache_find(KeyCacheEntry * cache, char const * data, size_t length) {
+	KeyCacheEntry * found;
+	int pos;
+
+	found = NULL;
+	for (pos = 0; (pos < CRYPTOSUPPORT_KEY_CACHE_SIZE) && (found == NULL); pos++) {
+		if ((cache[pos].base64 != NULL)
+			&& (buffer_get_pos(cache[pos].base64) == length)
+			&& (memcmp(buffer_get_buffer(cache[pos].base64), data, length) == 0)) {
+			found = & cache[pos];
+		}
+	}
+
+	if (found != NULL) {
+		cryptosupport_key_cache_clock++;
+		found->lastused = cryptosupport_key_cache_clock;
+	}
+
+	return found;
+}
+
+/**
+ * Claim a cache slot for the given base64 key text, evicting the least
+ * recently used entry if the cache is full. The returned entry has its text
+ * set and any previously held keys freed; the caller fills in the parsed
+ * key.
+ *
+ * @param cache The cache to insert into
+ * @param data The base64 key text to record
+ * @param length The length of the text in bytes
+ * @return The claimed entry
+ */
+static KeyCacheEntry * cryptosupport_key_cache_insert(KeyCacheEntry * cache, char const * data, size_t length) {
+	KeyCacheEntry * entry;
+	int pos;
+
+	entry = & cache[0];
+	for (pos = 1; pos < CRYPTOSUPPORT_KEY_CACHE_SIZE; pos++) {
+		if ((cache[pos].base64 == NULL) || (cache[pos].lastused < entry->lastused)) {
+			entry = & cache[pos];
+		}
+		if (cache[pos].base64 == NULL) {
+			break;
+		}
+	}
+
+	if (entry->base64 == NULL) {
+		entry->base64 = buffer_new(0);
+	}
+	buffer_clear(entry->base64);
+	buffer_append(entry->base64, data, length);
+
+	if (entry->eckey != NULL) {
+		EC_KEY_free(entry->eckey);
+		entry->eckey = NULL;
+	}
+	if (entry->pkey != NULL) {
+		EVP_PKEY_free(entry->pkey);
+		entry->pkey = NULL;
+	}
+
+	cryptosupport_key_cache_clock++;
+	entry->lastused = cryptosupport_key_cache_clock;
+
+	return entry;
+}
+
+/**
+ * Duplicate an elliptic curve private key. EVP_PKEY has no generic copy on
+ * the OpenSSL versions this library supports, so the EC key inside is
+ * duplicated and wrapped in a fresh EVP_PKEY.
+ *
+ * @param pkey The private key to copy
+ * @return A newly allocated copy, owned by the caller, or NULL on error
+ */
+static EVP_PKEY * cryptosupport_dup_private_key(EVP_PKEY * pkey) {
+	EVP_PKEY * duplicate;
+	EC_KEY * eckey;
+
+	duplicate = NULL;
+	eckey = EVP_PKEY_get1_EC_KEY(pkey);
+	if (eckey != NULL) {
+		duplicate = EVP_PKEY_new();
+		EVP_PKEY_assign_EC_KEY(duplicate, EC_KEY_dup(eckey));
+		EC_KEY_free(eckey);
+	}
+
+	return duplicate;
+}
+
+/**
+ * One-time library initialisation for the crypto support layer.
+ *
+ * The encryption and digest wrappers below all go through the EVP interface,
+ * which dispatches to hardware-accelerated implementations (AES-NI,
+ * PCLMULQDQ-based GHASH) when the CPU supports them. That dispatch relies on
+ * OpenSSL's cpuid setup having run, which on the 1.0.x series only happens
+ * once the algorithm tables have been registered. Register them from a
+ * constructor so every consumer of the library gets the accelerated paths
+ * without needing its own init call. From 1.1.0 onwards the library
+ * initialises itself automatically.
+ */
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+static void __attribute__((constructor)) cryptosupport_startup(void) {
+	OpenSSL_add_all_algorithms();
+	ERR_load_crypto_strings();
+}
+#endif
+
 /**
  * Return a PEM-encoded representation of a public key. This is a base64
  * encoded copy of the DER key, but without the standard header and footer
@@ -71,33 +282,28 @@
  * @return true if converted successfully, false o/w
  */
 bool cryptosupport_getpublicpem(EC_KEY * eckey, Buffer * buffer) {
-	BIO * mem = NULL;
-	long size;
-	char * data;
+	unsigned char derstack[CRYPTOSUPPORT_DER_STACK_SIZE];
+	unsigned char * der;
+	unsigned char * write;
 	int length;
 	bool result;
 
-	mem = BIO_new(BIO_s_mem());
-	if (mem != NULL) {
-		result = true;
-		//if (outformat == FORMAT_ASN1)
-		length = i2d_EC_PUBKEY_bio(mem, eckey);
-		//i = PEM_write_bio_EC_PUBKEY(mem, eckey);
-		if (length == 0) {
-			result = false;
-			LOG(LOG_ERR, "Error getting public key in PEM format\n");
-		}
-
-		data = NULL;
-		size = BIO_get_mem_data(mem, & data);
+	result = true;
+	length = i2d_EC_PUBKEY(eckey, NULL);
+	if (length > 0) {
+		der = (length <= (int)sizeof(derstack)) ? derstack : MALLOC(length);
+		write = der;
+		length = i2d_EC_PUBKEY(eckey, & write);
 
-		base64_encode_mem(data, size, buffer);
+		base64_encode_mem((char *)der, length, buffer);
 
-		BIO_free(mem);
+		if (der != derstack) {
+			FREE(der);
+		}
 	}
 	else {
 		result = false;
-		LOG(LOG_ERR, "Error opening memory stream to output PEM public key\n");
+		LOG(LOG_ERR, "Error getting public key in PEM format\n");
 	}
 
 	return result;
@@ -112,33 +318,28 @@ bool cryptosupport_getpublicpem(EC_KEY * eckey, Buffer * buffer) {
  * @return true if converted successfully, false o/w
  */
 bool cryptosupport_getpublicder(EC_KEY * eckey, Buffer * buffer) {
-	BIO * mem = NULL;
-	long size;
-	char * data;
+	unsigned char derstack[CRYPTOSUPPORT_DER_STACK_SIZE];
+	unsigned char * der;
+	unsigned char * write;
 	int length;
 	bool result;
-	
-	mem = BIO_new(BIO_s_mem());
-	if (mem != NULL) {
-		result = true;
-		//if (outformat == FORMAT_ASN1)
-		length = i2d_EC_PUBKEY_bio(mem, eckey);
-		//i = PEM_write_bio_EC_PUBKEY(mem, eckey);
-		if (length == 0) {
-			result = false;
-			LOG(LOG_ERR, "Error getting public key in DER format\n");
-		}
 
-		data = NULL;
-		size = BIO_get_mem_data(mem, & data);
+	result = true;
+	length = i2d_EC_PUBKEY(eckey, NULL);
+	if (length > 0) {
+		der = (length <= (int)sizeof(derstack)) ? derstack : MALLOC(length);
+		write = der;
+		length = i2d_EC_PUBKEY(eckey, & write);
 
-		buffer_append(buffer, data, size);
+		buffer_append(buffer, der, length);
 
-		BIO_free(mem);
+		if (der != derstack) {
+			FREE(der);
+		}
 	}
 	else {
 		result = false;
-		LOG(LOG_ERR, "Error opening memory stream to output DER public key\n");
+		LOG(LOG_ERR, "Error getting public key in DER format\n");
 	}
 
 	return result;
@@ -154,32 +355,33 @@ bool cryptosupport_getpublicder(EC_KEY * eckey, Buffer * buffer) {
  * @return true if converted successfully, false o/w
  */
 bool cryptosupport_getprivatepem(EVP_PKEY * pkey, Buffer * buffer) {
-	BIO * mem = NULL;
+	unsigned char derstack[CRYPTOSUPPORT_DER_STACK_SIZE];
+	unsigned char * der;
+	unsigned char * write;
 	PKCS8_PRIV_KEY_INFO * p8inf = NULL;
-	long size;
-	char * data;
+	int length;
 	bool result;
 
-	// TODO: Check whether p8inf should be freed using PKCS8_PRIV_KEY_INFO_free
 	result = true;
 	p8inf = EVP_PKEY2PKCS8(pkey);
 	if (p8inf != NULL) {
-		mem = BIO_new(BIO_s_mem());
-		if (mem != NULL) {
-			// ASN1
-			i2d_PKCS8_PRIV_KEY_INFO_bio(mem, p8inf);
-			// PEM
-			data = NULL;
-			size = BIO_get_mem_data(mem, & data);
+		length = i2d_PKCS8_PRIV_KEY_INFO(p8inf, NULL);
+		if (length > 0) {
+			der = (length <= (int)sizeof(derstack)) ? derstack : MALLOC(length);
+			write = der;
+			length = i2d_PKCS8_PRIV_KEY_INFO(p8inf, & write);
 
-			base64_encode_mem(data, size, buffer);
+			base64_encode_mem((char *)der, length, buffer);
 
-			BIO_free(mem);
+			if (der != derstack) {
+				FREE(der);
+			}
 		}
 		else {
 			result = false;
-			LOG(LOG_ERR, "Error opening memory stream to output PEM public key\n");
+			LOG(LOG_ERR, "Error getting private key in PEM format\n");
 		}
+		PKCS8_PRIV_KEY_INFO_free(p8inf);
 	}
 	else {
 		result = false;
@@ -198,32 +400,33 @@ bool cryptosupport_getprivatepem(EVP_PKEY * pkey, Buffer * buffer) {
  * @return true if converted successfully, false o/w
  */
 bool cryptosupport_getprivateder(EVP_PKEY * pkey, Buffer * buffer) {
-	BIO * mem = NULL;
+	unsigned char derstack[CRYPTOSUPPORT_DER_STACK_SIZE];
+	unsigned char * der;
+	unsigned char * write;
 	PKCS8_PRIV_KEY_INFO * p8inf = NULL;
-	long size;
-	char * data;
+	int length;
 	bool result;
 
-	// TODO: Check whether p8inf should be freed using PKCS8_PRIV_KEY_INFO_free
 	result = true;
 	p8inf = EVP_PKEY2PKCS8(pkey);
 	if (p8inf != NULL) {
-		mem = BIO_new(BIO_s_mem());
-		if (mem != NULL) {
-			// ASN1
-			i2d_PKCS8_PRIV_KEY_INFO_bio(mem, p8inf);
-			// PEM
-			data = NULL;
-			size = BIO_get_mem_data(mem, & data);
+		length = i2d_PKCS8_PRIV_KEY_INFO(p8inf, NULL);
+		if (length > 0) {
+			der = (length <= (int)sizeof(derstack)) ? derstack : MALLOC(length);
+			write = der;
+			length = i2d_PKCS8_PRIV_KEY_INFO(p8inf, & write);
 
-			buffer_append(buffer, data, size);
+			buffer_append(buffer, der, length);
 
-			BIO_free(mem);
+			if (der != derstack) {
+				FREE(der);
+			}
 		}
 		else {
 			result = false;
-			LOG(LOG_ERR, "Error opening memory stream to output PEM public key\n");
+			LOG(LOG_ERR, "Error getting private key in DER format\n");
 		}
+		PKCS8_PRIV_KEY_INFO_free(p8inf);
 	}
 	else {
 		result = false;
@@ -246,9 +449,11 @@ bool cryptosupport_generate_mac(Buffer * macKey, Buffer * data, Buffer * buffero
 	unsigned int len;
 	int result;
 
-	ctx = CALLOC(sizeof(HMAC_CTX), 1);
-
-	HMAC_CTX_init(ctx);
+	if (cryptosupport_hmac_ctx == NULL) {
+		cryptosupport_hmac_ctx = CALLOC(sizeof(HMAC_CTX), 1);
+		HMAC_CTX_init(cryptosupport_hmac_ctx);
+	}
+	ctx = cryptosupport_hmac_ctx;
 
 	result = HMAC_Init_ex(ctx, buffer_get_buffer(macKey), buffer_get_pos(macKey), EVP_sha256(), NULL);
 
@@ -262,10 +467,6 @@ bool cryptosupport_generate_mac(Buffer * macKey, Buffer * data, Buffer * buffero
 		buffer_set_pos(bufferout, len);
 	}
 
-	HMAC_CTX_cleanup(ctx);
-
-	FREE(ctx);
-
 	if (result != 1) {
 		LOG(LOG_ERR, "Error generating MAC: %lu\n", ERR_get_error());
 	}
@@ -296,7 +497,11 @@ bool cryptosupport_verify_signature(EC_KEY const * publickey, Buffer const * buf
 		pkey = EVP_PKEY_new();
 		EVP_PKEY_assign_EC_KEY(pkey, publickey);
 		digest_type = EVP_sha256();
-		mdctx = EVP_MD_CTX_create();
+		if (cryptosupport_verify_mdctx == NULL) {
+			cryptosupport_verify_mdctx = EVP_MD_CTX_create();
+		}
+		mdctx = cryptosupport_verify_mdctx;
+		EVP_MD_CTX_reset(mdctx);
 		result = EVP_DigestVerifyInit(mdctx, &pctx, digest_type, NULL, pkey);
 	}
 
@@ -308,8 +513,6 @@ bool cryptosupport_verify_signature(EC_KEY const * publickey, Buffer const * buf
 		result = EVP_DigestVerifyFinal(mdctx, (unsigned char *)buffer_get_buffer(sigin), buffer_get_pos(sigin));
 	}
 
-	EVP_MD_CTX_destroy(mdctx);
-
 	if (result == 0) {
 		LOG(LOG_ERR, "Error verifying signature: %lu\n", ERR_get_error());
 	}
@@ -329,14 +532,25 @@ bool cryptosupport_verify_signature(EC_KEY const * publickey, Buffer const * buf
 EC_KEY * cryptosupport_read_base64_buffer_public_key(Buffer * keybuffer) {
 	EC_KEY * eckey = NULL;
 	Buffer * decoded;
+	KeyCacheEntry * entry;
+
+	entry = cryptosupport_key_cache_find(cryptosupport_public_key_cache, buffer_get_buffer(keybuffer), buffer_get_pos(keybuffer));
+	if (entry != NULL) {
+		return EC_KEY_dup(entry->eckey);
+	}
 
-	decoded = buffer_new(base64_decode_size_max(buffer_get_pos(keybuffer)));
+	decoded = buffer_new(base64_decode_size_max_inline(buffer_get_pos(keybuffer)));
 	base64_decode_buffer(keybuffer, decoded);
 
 	eckey = cryptosupport_read_buffer_public_key(decoded);
 
 	buffer_delete(decoded);
 
+	if (eckey != NULL) {
+		entry = cryptosupport_key_cache_insert(cryptosupport_public_key_cache, buffer_get_buffer(keybuffer), buffer_get_pos(keybuffer));
+		entry->eckey = EC_KEY_dup(eckey);
+	}
+
 	return eckey;
 }
 
@@ -353,14 +567,27 @@ EC_KEY * cryptosupport_read_base64_buffer_public_key(Buffer * keybuffer) {
 EC_KEY * cryptosupport_read_base64_string_public_key(char const * keystring) {
 	EC_KEY * eckey = NULL;
 	Buffer * decoded;
+	KeyCacheEntry * entry;
+	size_t keylength;
+
+	keylength = strlen(keystring);
+	entry = cryptosupport_key_cache_find(cryptosupport_public_key_cache, keystring, keylength);
+	if (entry != NULL) {
+		return EC_KEY_dup(entry->eckey);
+	}
 
-	decoded = buffer_new(base64_decode_size_max(strlen(keystring)));
+	decoded = buffer_new(base64_decode_size_max_inline(keylength));
 	base64_decode_string(keystring, decoded);
 
 	eckey = cryptosupport_read_buffer_public_key(decoded);
 
 	buffer_delete(decoded);
 
+	if (eckey != NULL) {
+		entry = cryptosupport_key_cache_insert(cryptosupport_public_key_cache, keystring, keylength);
+		entry->eckey = EC_KEY_dup(eckey);
+	}
+
 	return eckey;
 }
 
@@ -378,6 +605,7 @@ EC_KEY * cryptosupport_read_base64_string_public_key(char const * keystring) {
  */
 EC_KEY * cryptosupport_read_buffer_public_key(Buffer * keybuffer) {
 	EC_KEY * eckey = NULL;
+	EC_GROUP const * group;
 	unsigned char const * keydata;
 
 	keydata = (unsigned char const *)buffer_get_buffer(keybuffer);
@@ -388,6 +616,16 @@ EC_KEY * cryptosupport_read_buffer_public_key(Buffer * keybuffer) {
 		//ERR_load_crypto_strings();
 		//LOG(LOG_ERR, "%s\n", ERR_error_string(ERR_get_error(), NULL));
 	}
+	else {
+		// Swap in the library's shared curve group when the key is on the
+		// library curve: the parse builds a bare group, while the shared
+		// one carries the precomputed generator tables, so signature
+		// verification against this key takes the fixed-base fast path
+		group = EC_KEY_get0_group(eckey);
+		if ((group != NULL) && (EC_GROUP_get_curve_name(group) == CRYPTOSUPPORT_ECCURVE)) {
+			EC_KEY_set_group(eckey, keypair_get_group());
+		}
+	}
 
 	return eckey;
 }
@@ -404,14 +642,25 @@ EC_KEY * cryptosupport_read_buffer_public_key(Buffer * keybuffer) {
 EVP_PKEY * cryptosupport_read_base64_buffer_private_key(Buffer * keybuffer) {
 	EVP_PKEY * pkey = NULL;
 	Buffer * decoded;
+	KeyCacheEntry * entry;
+
+	entry = cryptosupport_key_cache_find(cryptosupport_private_key_cache, buffer_get_buffer(keybuffer), buffer_get_pos(keybuffer));
+	if (entry != NULL) {
+		return cryptosupport_dup_private_key(entry->pkey);
+	}
 
-	decoded = buffer_new(base64_decode_size_max(buffer_get_pos(keybuffer)));
+	decoded = buffer_new(base64_decode_size_max_inline(buffer_get_pos(keybuffer)));
 	base64_decode_buffer(keybuffer, decoded);
 
 	pkey = cryptosupport_read_buffer_private_key(decoded);
 
 	buffer_delete(decoded);
 
+	if (pkey != NULL) {
+		entry = cryptosupport_key_cache_insert(cryptosupport_private_key_cache, buffer_get_buffer(keybuffer), buffer_get_pos(keybuffer));
+		entry->pkey = cryptosupport_dup_private_key(pkey);
+	}
+
 	return pkey;
 }
 
@@ -428,14 +677,27 @@ EVP_PKEY * cryptosupport_read_base64_buffer_private_key(Buffer * keybuffer) {
 EVP_PKEY * cryptosupport_read_base64_string_private_key(char const * keystring) {
 	EVP_PKEY * pkey = NULL;
 	Buffer * decoded;
+	KeyCacheEntry * entry;
+	size_t keylength;
+
+	keylength = strlen(keystring);
+	entry = cryptosupport_key_cache_find(cryptosupport_private_key_cache, keystring, keylength);
+	if (entry != NULL) {
+		return cryptosupport_dup_private_key(entry->pkey);
+	}
 
-	decoded = buffer_new(base64_decode_size_max(strlen(keystring)));
+	decoded = buffer_new(base64_decode_size_max_inline(keylength));
 	base64_decode_string(keystring, decoded);
 
 	pkey = cryptosupport_read_buffer_private_key(decoded);
 
 	buffer_delete(decoded);
 
+	if (pkey != NULL) {
+		entry = cryptosupport_key_cache_insert(cryptosupport_private_key_cache, keystring, keylength);
+		entry->pkey = cryptosupport_dup_private_key(pkey);
+	}
+
 	return pkey;
 }
 
@@ -483,6 +745,7 @@ bool cryptosupport_encrypt(Buffer const * key, Buffer const * iv, Buffer const *
 	size_t length_written;
 	unsigned char * bufferout;
 	size_t length_iv;
+	bool samekey;
 	int result;
 
 	length_iv = buffer_get_pos(iv);
@@ -492,14 +755,36 @@ bool cryptosupport_encrypt(Buffer const * key, Buffer const * iv, Buffer const *
 	length_written = 0;
 	bufferout = (unsigned char *)buffer_get_buffer(encryptedout);
 
-	ctx = EVP_CIPHER_CTX_new();
-	//EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, iv);
-	result = EVP_CipherInit_ex(ctx, EVP_aes_128_gcm(), NULL, NULL, NULL, 1);
+	if (cryptosupport_encrypt_ctx == NULL) {
+		cryptosupport_encrypt_ctx = EVP_CIPHER_CTX_new();
+		cryptosupport_encrypt_key_valid = false;
+	}
+	ctx = cryptosupport_encrypt_ctx;
 
-	if (result == 1) {
+	samekey = cryptosupport_encrypt_key_valid
+		&& (buffer_get_pos(key) == sizeof(cryptosupport_encrypt_key))
+		&& (CRYPTO_memcmp(cryptosupport_encrypt_key, buffer_get_buffer(key), sizeof(cryptosupport_encrypt_key)) == 0);
+
+	if (samekey) {
+		// Same key as the previous call: keep the cached key schedule and
+		// only re-initialise the IV
 		EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, length_iv, NULL);
+		result = EVP_CipherInit_ex(ctx, NULL, NULL, NULL, (unsigned char const *)buffer_get_buffer(iv), 1);
+	}
+	else {
+		//EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, iv);
+		result = EVP_CipherInit_ex(ctx, EVP_aes_128_gcm(), NULL, NULL, NULL, 1);
+
+		if (result == 1) {
+			EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, length_iv, NULL);
 
-		result = EVP_CipherInit_ex(ctx, NULL, NULL, (unsigned char const *)buffer_get_buffer(key), (unsigned char const *)buffer_get_buffer(iv), 1);
+			result = EVP_CipherInit_ex(ctx, NULL, NULL, (unsigned char const *)buffer_get_buffer(key), (unsigned char const *)buffer_get_buffer(iv), 1);
+		}
+
+		if ((result == 1) && (buffer_get_pos(key) == sizeof(cryptosupport_encrypt_key))) {
+			memcpy(cryptosupport_encrypt_key, buffer_get_buffer(key), sizeof(cryptosupport_encrypt_key));
+			cryptosupport_encrypt_key_valid = true;
+		}
 	}
 
 	if (result == 1) {
@@ -523,9 +808,9 @@ bool cryptosupport_encrypt(Buffer const * key, Buffer const * iv, Buffer const *
 		buffer_set_pos(encryptedout, length_written);
 	}
 
-	EVP_CIPHER_CTX_free(ctx);
-
 	if (result != 1) {
+		// Don't trust the cached key schedule after a failure
+		cryptosupport_encrypt_key_valid = false;
 		LOG(LOG_ERR, "Error encrypting data: %lu\n", ERR_get_error());
 	}
 
@@ -536,6 +821,16 @@ bool cryptosupport_encrypt(Buffer const * key, Buffer const * iv, Buffer const *
  * Decrypt data encrypted using AES128 GCM. GCM includes a proceeding MAC for 
  * integrity and the decryption will fail if this doesn't match the data.
  *
+ * The whole ciphertext is handed to EVP_CipherUpdate in a single call over
+ * the contiguous Buffer storage, which lets OpenSSL's multi-block AES-NI
+ * assembly pipeline the blocks internally; splitting the input into
+ * per-block calls would defeat that, so don't.
+ *
+ * Decrypting in place is supported: cleartextout may be the same Buffer
+ * as bufferin, in which case the plaintext overwrites the ciphertext
+ * bytes (the GCM tag sits after them and is read before being reached).
+ * On failure the buffer contents are undefined.
+ *
  * @param key The 128-bit key to use to decrypt the data, in binary format
  * @param iv The IV used to encrypt the data
  * @param bufferin The encrypted data to decrypt
@@ -551,6 +846,7 @@ bool cryptosupport_decrypt(Buffer const * key, Buffer const * iv, Buffer const *
 	unsigned char * bufferstart;
 	unsigned char * bufferout;
 	size_t length_iv;
+	bool samekey;
 	int result;
 
 	length_iv = buffer_get_pos(iv);
@@ -561,14 +857,36 @@ bool cryptosupport_decrypt(Buffer const * key, Buffer const * iv, Buffer const *
 	bufferstart = (unsigned char *)buffer_get_buffer(bufferin);
 	bufferout = (unsigned char *)buffer_get_buffer(cleartextout);
 
-	ctx = EVP_CIPHER_CTX_new();
-	//result = EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, iv);
-	result = EVP_CipherInit_ex(ctx, EVP_aes_128_gcm(), NULL, NULL, NULL, 0);
+	if (cryptosupport_decrypt_ctx == NULL) {
+		cryptosupport_decrypt_ctx = EVP_CIPHER_CTX_new();
+		cryptosupport_decrypt_key_valid = false;
+	}
+	ctx = cryptosupport_decrypt_ctx;
 
-	if (result == 1) {
+	samekey = cryptosupport_decrypt_key_valid
+		&& (buffer_get_pos(key) == sizeof(cryptosupport_decrypt_key))
+		&& (CRYPTO_memcmp(cryptosupport_decrypt_key, buffer_get_buffer(key), sizeof(cryptosupport_decrypt_key)) == 0);
+
+	if (samekey) {
+		// Same key as the previous call: keep the cached key schedule and
+		// only re-initialise the IV
 		EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, length_iv, NULL);
+		result = EVP_CipherInit_ex(ctx, NULL, NULL, NULL, (unsigned char const *)buffer_get_buffer(iv), 0);
+	}
+	else {
+		//result = EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, iv);
+		result = EVP_CipherInit_ex(ctx, EVP_aes_128_gcm(), NULL, NULL, NULL, 0);
+
+		if (result == 1) {
+			EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, length_iv, NULL);
 
-		result = EVP_CipherInit_ex(ctx, NULL, NULL, (unsigned char const *)buffer_get_buffer(key), (unsigned char const *)buffer_get_buffer(iv), 0);
+			result = EVP_CipherInit_ex(ctx, NULL, NULL, (unsigned char const *)buffer_get_buffer(key), (unsigned char const *)buffer_get_buffer(iv), 0);
+		}
+
+		if ((result == 1) && (buffer_get_pos(key) == sizeof(cryptosupport_decrypt_key))) {
+			memcpy(cryptosupport_decrypt_key, buffer_get_buffer(key), sizeof(cryptosupport_decrypt_key));
+			cryptosupport_decrypt_key_valid = true;
+		}
 	}
 
 	if (result == 1) {
@@ -592,9 +910,10 @@ bool cryptosupport_decrypt(Buffer const * key, Buffer const * iv, Buffer const *
 	//EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, CRYPTOSUPPORT_TAG_LENGTH, bufferout + length_written);
 	//length_written += CRYPTOSUPPORT_TAG_LENGTH;
 
-	EVP_CIPHER_CTX_free(ctx);
-
 	if (result != 1) {
+		// A failed decrypt (e.g. bad tag) leaves the context state
+		// undefined, so force a full re-key next time
+		cryptosupport_decrypt_key_valid = false;
 		LOG(LOG_ERR, "Error decrypting data: %lu\n", ERR_get_error());
 	}
 
@@ -621,11 +940,13 @@ bool cryptosupport_encrypt_iv_base64(Buffer const * key, Buffer const * bufferin
 	if (key && bufferin && encryptedout) {
 		iv = buffer_new(CRYPTOSUPPORT_IV_SIZE);
 		cryptosupport_generate_iv(iv);
-		encrypted = buffer_new(0);
+		// Size the ciphertext buffer for the output cryptosupport_encrypt
+		// will produce, so it never has to grow mid-encrypt
+		encrypted = buffer_new(buffer_get_pos(bufferin) + EVP_MAX_BLOCK_LENGTH + CRYPTOSUPPORT_TAG_LENGTH);
 
 		result = cryptosupport_encrypt(key, iv, bufferin, encrypted);
 		if (result) {
-			base64 = buffer_new(0);
+			base64 = buffer_new(base64_encode_size_max(buffer_get_pos(encrypted)));
 
 			buffer_clear(encryptedout);
 			// Add the base64-encoded IV
@@ -639,6 +960,9 @@ bool cryptosupport_encrypt_iv_base64(Buffer const * key, Buffer const * bufferin
 
 			buffer_delete(base64);
 		}
+
+		buffer_delete(iv);
+		buffer_delete(encrypted);
 	}
 
 	return result;
@@ -661,6 +985,7 @@ bool cryptosupport_decrypt_iv_base64(Buffer const * key, Buffer const * bufferin
 	Buffer * iv;
 	Buffer * ciphertext;
 	char * start;
+	char * separator;
 	unsigned int end;
 	unsigned int pos;
 
@@ -670,10 +995,8 @@ bool cryptosupport_decrypt_iv_base64(Buffer const * key, Buffer const * bufferin
 
 		if (start) {
 			end = buffer_get_pos(bufferin);
-			pos = 0;
-			while ((pos < end) && (start[pos] != ':')) {
-				pos++;
-			}
+			separator = memchr(start, ':', end);
+			pos = (separator != NULL) ? (separator - start) : end;
 
 			if ((pos > 0) && (pos < end)) {
 				iv = buffer_new(0);
@@ -756,7 +1079,10 @@ bool cryptosupport_generate_sha256(Buffer * bufferin, Buffer * bufferout) {
 	buffer_set_min_size(bufferout, EVP_MAX_MD_SIZE);
 
 	digest_type = EVP_sha256();
-	mdctx = EVP_MD_CTX_create();
+	if (cryptosupport_sha256_mdctx == NULL) {
+		cryptosupport_sha256_mdctx = EVP_MD_CTX_create();
+	}
+	mdctx = cryptosupport_sha256_mdctx;
 
 	result = EVP_DigestInit_ex(mdctx, digest_type, NULL);
 	if (result == 1) {
@@ -771,8 +1097,6 @@ bool cryptosupport_generate_sha256(Buffer * bufferin, Buffer * bufferout) {
 		buffer_set_pos(bufferout, length);
 	}
 
-	EVP_MD_CTX_destroy(mdctx);
-
 	if (result < 0) {
 		LOG(LOG_ERR, "Error hashing sha256: %lu\n", ERR_get_error());
 	}
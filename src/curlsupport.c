@@ -38,6 +38,8 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include "pico/debug.h"
 #include "pico/buffer.h"
 #include "pico/log.h"
@@ -49,8 +51,31 @@
 
 // Function prototypes
 
+static bool curlsupport_data_size(size_t size, size_t nmemb, size_t * total);
+
 // Function definitions
 
+/**
+ * Internal function computing the number of bytes in a chunk handed over by
+ * libcurl, guarding the size * nmemb multiplication against overflow.
+ *
+ * @param size Number of data items returned by libcurl
+ * @param nmemb Size of each data item in bytes
+ * @param total Out parameter for the chunk size in bytes
+ * @return true if the product fits in a size_t, false on overflow
+ */
+static bool curlsupport_data_size(size_t size, size_t nmemb, size_t * total) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_expect(__builtin_mul_overflow(size, nmemb, total), 0) == 0;
+#else
+	if ((nmemb > 0) && (size > SIZE_MAX / nmemb)) {
+		return false;
+	}
+	*total = size * nmemb;
+	return true;
+#endif
+}
+
 /**
  * Convenience function for use as a CURL callback. Writes the data to a
  * user-provided buffer. This function should never be called directy, but
@@ -67,8 +92,13 @@
 size_t write_data(void * ptr, size_t size, size_t nmemb, void * userp) {
 	Buffer * buffer = (Buffer *)userp;
 	size_t stored;
+	size_t total;
+
+	if (curlsupport_data_size(size, nmemb, & total) == false) {
+		return 0;
+	}
 
-	stored = buffer_append(buffer, ptr, size * nmemb);
+	stored = buffer_append(buffer, ptr, total);
 	
 	return stored;
 }
@@ -86,15 +116,28 @@ size_t write_data(void * ptr, size_t size, size_t nmemb, void * userp) {
  *         quantity of data provided by libcurl unless an error occurred
  */
 size_t print_data(void * ptr, size_t size, size_t nmemb, void * userp) {
-	Buffer * buffer;
-
-	buffer = buffer_new(size * nmemb);
-	buffer_append(buffer, ptr, size * nmemb);
+	size_t total;
+
+	if (curlsupport_data_size(size, nmemb, & total) == false) {
+		return 0;
+	}
+
+	// Write the chunk out directly; curl hands over the data it received, so
+	// there is nothing to gain from staging it in a Buffer first. The stdio
+	// lock is taken once for the whole chunk rather than per stdio call
+#if defined(__GNUC__) && !defined(_WIN32) && !defined(_WIN64)
+	flockfile(stdout);
+	fwrite_unlocked("Response: ", 1, sizeof("Response: ") - 1, stdout);
+	fwrite_unlocked(ptr, 1, total, stdout);
+	fputc_unlocked('\n', stdout);
+	funlockfile(stdout);
+#else
 	printf("Response: ");
-	buffer_print(buffer);
-	buffer_delete(buffer);
+	fwrite(ptr, 1, total, stdout);
+	printf("\n");
+#endif
 
-	return size * nmemb;
+	return total;
 }
 
 /**
@@ -110,15 +153,17 @@ size_t print_data(void * ptr, size_t size, size_t nmemb, void * userp) {
  *         quantity of data provided by libcurl unless an error occurred
  */
 size_t log_data(void * ptr, size_t size, size_t nmemb, void * userp) {
-	Buffer * buffer;
+	size_t total;
+
+	if (curlsupport_data_size(size, nmemb, & total) == false) {
+		return 0;
+	}
 
-	buffer = buffer_new(size * nmemb);
-	buffer_append(buffer, ptr, size * nmemb);
-	LOG(LOG_INFO, "Response: "); 
-	buffer_log(buffer);
-	buffer_delete(buffer);
+	// Log the chunk in a single call with a bounded format, rather than
+	// copying it into a Buffer to gain a null terminator
+	LOG(LOG_INFO, "Response: %.*s\n", (int)total, (char const *)ptr);
 
-	return size * nmemb;
+	return total;
 }
 
 /** @} addtogroup Communication */
@@ -98,7 +98,11 @@ void * debug_malloc(size_t __size) {
  */
 void * debug_calloc(size_t __nmemb, size_t __size) {
 	allocations++;
+#if defined(__GNUC__) || defined(__clang__)
+	return pico_calloc(__nmemb, __size);
+#else
 	return calloc(__nmemb, __size);
+#endif
 }
 
 /**
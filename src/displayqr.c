@@ -26,12 +26,24 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
 #if defined(_WIN32) || defined(_WIN64)
 #include "qrencode.h"
 #else
 #include <unistd.h>
 #include <qrencode.h>
 #endif
+#if defined(__has_include)
+#if __has_include(<qrencode_inner.h>)
+// Exposes QRcode_encodeMask(), used to encode with a caller-chosen mask
+// pattern instead of trialling all eight
+#include <qrencode_inner.h>
+#define HAVE_QRENCODE_INNER_H (1)
+#endif
+#endif
 #include "pico/debug.h"
 #include "pico/buffer.h"
 #include "pico/log.h"
@@ -67,6 +79,12 @@ struct _DisplayQR {
 	QRMODE qr_mode;
 	void * mode_param;
 	Buffer * output;
+	int fixed_mask;
+	Buffer * last_text;
+	size_t last_width;
+	// Scratch arena for the renderers' row data, reused across renders so
+	// repeat generation stays off the allocator
+	Buffer * scratch;
 };
 
 // Function prototypes
@@ -88,6 +106,10 @@ DisplayQR * displayqr_new() {
 	displayqr->qr_mode = QRMODE_COLOR_UTF8;
 	displayqr->mode_param = NULL;
 	displayqr->output = buffer_new(0);
+	displayqr->fixed_mask = -1;
+	displayqr->last_text = buffer_new(0);
+	displayqr->last_width = 0;
+	displayqr->scratch = buffer_new(0);
 
 	return displayqr;
 }
@@ -105,6 +127,10 @@ DisplayQR * displayqr_new_params(QRMODE qr_mode) {
 	displayqr->qr_mode = qr_mode;
 	displayqr->mode_param = NULL;
 	displayqr->output = buffer_new(0);
+	displayqr->fixed_mask = -1;
+	displayqr->last_text = buffer_new(0);
+	displayqr->last_width = 0;
+	displayqr->scratch = buffer_new(0);
 
 	return displayqr;
 }
@@ -127,6 +153,36 @@ void displayqr_set_mode_params(DisplayQR * displayqr, void * param) {
 
 		displayqr->mode_param = MALLOC(sizeof(int));
 		memcpy(displayqr->mode_param, param, sizeof(int));
+
+		// The cached output no longer matches the parameters
+		buffer_clear(displayqr->last_text);
+	}
+}
+
+/**
+ * Fix the mask pattern used when generating QR codes, instead of having the
+ * encoder trial all eight patterns and score each with the penalty rules.
+ * Skipping the trials makes generation considerably faster, at the cost of a
+ * potentially less readable (but still valid and scannable) code; useful on
+ * interactive paths that regenerate codes frequently.
+ *
+ * Note that the penalty evaluation itself (four separate rule passes over
+ * the module grid per mask trial) is internal to libqrencode and cannot be
+ * restructured from here; pinning the mask is the supported way to take it
+ * off the generation path entirely.
+ *
+ * Only takes effect when libqrencode's inner interface is available at
+ * compile time; otherwise the encoder continues to choose the mask itself.
+ *
+ * @param displayqr The displayqr object
+ * @param mask The mask pattern to use (0 to 7), or -1 to restore automatic
+ *        mask selection
+ */
+void displayqr_set_fixed_mask(DisplayQR * displayqr, int mask) {
+	if ((mask >= -1) && (mask <= 7)) {
+		displayqr->fixed_mask = mask;
+		// The cached output no longer matches the parameters
+		buffer_clear(displayqr->last_text);
 	}
 }
 
@@ -140,6 +196,12 @@ void displayqr_delete(DisplayQR * displayqr) {
 		if (displayqr->output) {
 			buffer_delete(displayqr->output);
 		}
+		if (displayqr->last_text) {
+			buffer_delete(displayqr->last_text);
+		}
+		if (displayqr->scratch) {
+			buffer_delete(displayqr->scratch);
+		}
 		if (displayqr->mode_param) {
 			FREE(displayqr->mode_param);
 		}
@@ -356,31 +418,58 @@ void displayqr_generate_color_spaces(DisplayQR* displayqr, QRcode* qrcode) {
 
 /**
  * Internal function for displayqr_monochrome_bitmap
- * It appends a single bit for a byte variable, and appends the whole byte to a buffer if completed
+ * Sets a run of bits in a bit-packed row, most significant bit first within
+ * each byte. Whole bytes in the middle of the run are set with a single
+ * memset rather than bit by bit.
  *
- * @param buffer Buffer to be appended if byte is complete
- * @param byte single byte variable where we as keeping the constructed byte
- * @param count how many bits of byte where already filled. This should always be less than 8, otherwise
- * 				byte has a complete byte that should be in buffer.
- * @param bit The bit to be appended. 0 or 1.
+ * @param rowdata The bit-packed row to write into
+ * @param start Index of the first bit to set
+ * @param length The number of bits to set
  */
-void append_bit(Buffer * buffer, unsigned char * byte, int * count, char bit) {
-	if (bit & 1) {
-		// Black
-		(*count)++;
+static void displayqr_set_bits(unsigned char * rowdata, int start, int length) {
+	int firstbyte;
+	int lastbyte;
+	unsigned char firstmask;
+	unsigned char lastmask;
+
+	if (length <= 0) {
+		return;
+	}
+
+	firstbyte = start >> 3;
+	lastbyte = (start + length - 1) >> 3;
+	firstmask = 0xff >> (start & 7);
+	lastmask = 0xff << (7 - ((start + length - 1) & 7));
+
+	if (firstbyte == lastbyte) {
+		rowdata[firstbyte] |= firstmask & lastmask;
 	}
 	else {
-		// White
-		*byte |= (1 << (7 - *count));
-		(*count)++;
+		rowdata[firstbyte] |= firstmask;
+		memset(rowdata + firstbyte + 1, 0xff, lastbyte - firstbyte - 1);
+		rowdata[lastbyte] |= lastmask;
 	}
+}
 
-	if (*count == 8) {
-		// If we completed a byte, append to the output
-		buffer_append(buffer, byte, 1);
-		*count = 0;
-		*byte = 0x00;
-	}
+/**
+ * Internal function for displayqr_monochrome_bitmap
+ * Packs the low bits of eight consecutive modules into a single byte, most
+ * significant bit first, so a set bit marks a black module. With BMI2 this
+ * is a byte swap plus one pext; otherwise a SWAR multiply gathers the eight
+ * bits in a single 64-bit product.
+ *
+ * @param modules Pointer to the first of eight module bytes
+ * @return The eight module bits packed into one byte
+ */
+static unsigned char displayqr_pack_modules(char const * modules) {
+	uint64_t chunk;
+
+	memcpy(& chunk, modules, sizeof(chunk));
+#if defined(__BMI2__)
+	return (unsigned char)_pext_u64(__builtin_bswap64(chunk), 0x0101010101010101ull);
+#else
+	return (unsigned char)(((chunk & 0x0101010101010101ull) * 0x8040201008040201ull) >> 56);
+#endif
 }
 
 /**
@@ -388,6 +477,10 @@ void append_bit(Buffer * buffer, unsigned char * byte, int * count, char bit) {
  * Generates a buffer containing a monochrome bitmap according to Microsoft documentation
  * https://msdn.microsoft.com/en-us/library/windows/desktop/dd162461(v=vs.85).aspx
  *
+ * Each row is packed into a reused byte array with word-at-a-time bit runs
+ * (rather than appending one bit at a time) and appended to the output in a
+ * single operation. A set bit is white, a clear bit is black.
+ *
  * @param displayqr The DisplayQR where the bitmap will be output
  * @param qrcode The QRcode where the data was generated
  */
@@ -396,9 +489,12 @@ void displayqr_monochrome_bitmap(DisplayQR* displayqr, QRcode* qrcode) {
 	int i;
 	int y;
 	int x;
-	unsigned char byte = 0x00;
-	int count = 0;
 	int pixels = 1;
+	int rowbits;
+	int rowfull;
+	int rowbytes;
+	int bit;
+	unsigned char * rowdata;
 
 	if (displayqr->mode_param != NULL) {
 		pixels = *(int*)displayqr->mode_param;
@@ -409,73 +505,74 @@ void displayqr_monochrome_bitmap(DisplayQR* displayqr, QRcode* qrcode) {
 	// In Windows, WORD is 16 bits, and DWORD is 32 bits.
 	const int alignment = 16;
 
-	Buffer * row = buffer_new(0);
+	// Each row is the code plus a border of two modules either side, scaled
+	// up, then zero-padded to the alignment
+	rowbits = (qrcode->width + 4) * pixels;
+	rowfull = (rowbits + 7) / 8;
+	rowbytes = ((rowfull + (alignment / 8) - 1) / (alignment / 8)) * (alignment / 8);
 
-	// Two white rows
-	for (i = 0; i < 2 * pixels; i++) {
-		// Set all the bits as 1. This might overshoot in the last byte, but this is intended
-		for (x = 0; x < (qrcode->width + 4) * pixels; x += 8) {
-			buffer_append(displayqr->output, "\xff", 1);
-		}
-		// Append zero bytes if not aligned
-		while (buffer_get_pos(displayqr->output) % (alignment >> 3) != 0) {
-			buffer_append(displayqr->output, "\x00", 1);
-		}
-	}
+	// Borrow the row from the persistent scratch arena; after the first
+	// render at a given size this allocates nothing
+	buffer_set_min_size(displayqr->scratch, rowbytes);
+	rowdata = (unsigned char *)buffer_get_buffer(displayqr->scratch);
+	memset(rowdata, 0, rowbytes);
 
-	// Border
+	// Two white rows
+	// Setting all the bits might overshoot in the last byte, but this is intended
+	memset(rowdata, 0xff, rowfull);
 	for (i = 0; i < 2 * pixels; i++) {
-		append_bit(row, &byte, &count, 0);
+		buffer_append(displayqr->output, rowdata, rowbytes);
 	}
 
-	for (y = 0; y < qrcode->width * qrcode->width; y++) {
-		for (i = 0; i < pixels; i++) {
-			append_bit(row, &byte, &count, *ptr);
-		}
-
-		ptr++;
-
-		// Last pixel of a row
-		if ((y + 1) % qrcode->width == 0) {
-			// Border
-			for (i = 0; i < 2 * pixels; i++) {
-				append_bit(row, &byte, &count, 0);
-			}
-
-			if (count > 0) {
-				buffer_append(row, &byte, 1);
-				count = 0;
-				byte = 0x00;
+	for (y = 0; y < qrcode->width; y++) {
+		memset(rowdata, 0, rowbytes);
+		// Border
+		displayqr_set_bits(rowdata, 0, 2 * pixels);
+		bit = 2 * pixels;
+		if (pixels == 1) {
+			// Unscaled rows map one module to one bit, so eight modules
+			// pack into a byte at a time; the two-bit border offsets the
+			// packed byte across a pair of output bytes. A set output bit
+			// is white, so the packed black bits are inverted
+			unsigned char packed;
+
+			for (x = 0; x + 8 <= qrcode->width; x += 8) {
+				packed = (unsigned char)(~displayqr_pack_modules(ptr + x));
+				rowdata[(bit + x) >> 3] |= (unsigned char)(packed >> 2);
+				rowdata[((bit + x) >> 3) + 1] |= (unsigned char)(packed << 6);
 			}
-
-			// Append zeroes if not aligned
-			while (buffer_get_pos(row) % (alignment / 8) != 0) {
-					buffer_append(row, "\x00", 1);
+			for (; x < qrcode->width; x++) {
+				if ((ptr[x] & 1) == 0) {
+					// White
+					displayqr_set_bits(rowdata, bit + x, 1);
+				}
 			}
-
-			for (i = 0; i < pixels; i++) {
-				buffer_append_buffer(displayqr->output, row);
+			ptr += qrcode->width;
+			bit += qrcode->width;
+		}
+		else {
+			for (x = 0; x < qrcode->width; x++) {
+				if ((*ptr++ & 1) == 0) {
+					// White
+					displayqr_set_bits(rowdata, bit, pixels);
+				}
+				bit += pixels;
 			}
-			buffer_clear(row);
+		}
+		// Border
+		displayqr_set_bits(rowdata, bit, 2 * pixels);
 
-			// Border
-			for (i = 0; i < 2 * pixels; i++) {
-				append_bit(row, &byte, &count, 0);
-			}
+		for (i = 0; i < pixels; i++) {
+			buffer_append(displayqr->output, rowdata, rowbytes);
 		}
 	}
 
 	// Two white rows again
+	memset(rowdata, 0, rowbytes);
+	memset(rowdata, 0xff, rowfull);
 	for (i = 0; i < 2 * pixels; i++) {
-		for (x = 0; x < (qrcode->width + 4) * pixels; x += 8) {
-			buffer_append(displayqr->output, "\xff", 1);
-		}
-		while (buffer_get_pos(displayqr->output) % (alignment / 8) != 0) {
-			buffer_append(displayqr->output, "\x00", 1);
-		}	
+		buffer_append(displayqr->output, rowdata, rowbytes);
 	}
-
-	buffer_delete(row);
 }
 
 /**
@@ -529,8 +626,32 @@ size_t displayqr_generate(DisplayQR * displayqr, const char * text) {
 	size_t ret = 0;
 
 	if (displayqr->qr_mode != QRMODE_NONE) {
+		// Generating a QR code means Reed-Solomon coding, fixed-pattern
+		// placement and mask scoring in the encoder; if the text is the
+		// same as last time the cached output is still valid, so skip
+		// all of that and return it directly
+		size_t textlen = strlen(text);
+		if ((buffer_get_pos(displayqr->last_text) == textlen) && (textlen > 0)
+			&& (memcmp(buffer_get_buffer(displayqr->last_text), text, textlen) == 0)) {
+			return displayqr->last_width;
+		}
 		buffer_clear(displayqr->output);
-		QRcode *qrcode = QRcode_encodeString8bit(text, 0, 1);
+		QRcode *qrcode = NULL;
+#if defined(HAVE_QRENCODE_INNER_H)
+		if (displayqr->fixed_mask >= 0) {
+			// Encode with the fixed mask pattern, skipping the
+			// penalty-scoring trial of all eight patterns
+			QRinput *input = QRinput_new2(0, 1);
+			if (input != NULL) {
+				QRinput_append(input, QR_MODE_8, strlen(text), (unsigned char const *)text);
+				qrcode = QRcode_encodeMask(input, displayqr->fixed_mask);
+				QRinput_free(input);
+			}
+		}
+#endif
+		if (qrcode == NULL) {
+			qrcode = QRcode_encodeString8bit(text, 0, 1);
+		}
 		// Output QRCode using ANSI colors. Instead of black on white, we
 		// output black on grey, as that works independently of whether the
 		// user runs his terminals in a black on white or white on black color
@@ -556,6 +677,10 @@ size_t displayqr_generate(DisplayQR * displayqr, const char * text) {
 
 		ret = qrcode->width;
 
+		buffer_clear(displayqr->last_text);
+		buffer_append_string(displayqr->last_text, text);
+		displayqr->last_width = ret;
+
 		QRcode_free(qrcode);
 	}
 
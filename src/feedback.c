@@ -41,24 +41,47 @@
 //#include <malloc.h>
 #include "pico/debug.h"
 #include "pico/feedback.h"
+#include "pico/feedback_internal.h"
 
 // Defines
 
 // Structure definitions
 
-struct _Feedback {
-	FeedbackTrigger trigger;
-	void * data;
+// The structure layout lives in feedback_internal.h so that the optional
+// header-inline accessors see the same definition
 
-	int stage;
-	int stages;
-	Buffer * description;
+// Function prototypes
+
+// Global variables
+
+// Stage descriptions for the feedback accessors declared in feedback.h,
+// packed into a single string table per role with byte offsets
+char const feedbackAuthVerifierStrings[] =
+	"Starting up\0"
+	"Generating keys\0"
+	"Ready to log in\0"
+	"Contacted the Pico app\0"
+	"Authenticating computer\0"
+	"Authenticating you\0"
+	"Authentication complete\0"
+	"Finalising\0"
+	"Finalised";
 
-	// Special stages
-	int remove_qr;
+uint8_t const feedbackAuthVerifierOffsets[FEEDBACKAUTHVERIFIER_NUM] = {
+	0, 12, 28, 44, 67, 91, 110, 134, 145
 };
 
-// Function prototypes
+char const feedbackAuthProverStrings[] =
+	"Initialising\0"
+	"Contacting service\0"
+	"Authenticating service\0"
+	"Authenticating Pico\0"
+	"Waiting for result\0"
+	"Sigma protocol complete";
+
+uint8_t const feedbackAuthProverOffsets[FEEDBACKAUTHPROVER_NUM] = {
+	0, 13, 32, 55, 75, 94
+};
 
 // Function definitions
 
@@ -70,14 +93,11 @@ struct _Feedback {
 Feedback * feedback_new() {
 	Feedback * feedback;
 
+	// calloc zeroes the structure, so only the non-zero fields need
+	// setting explicitly
 	feedback = calloc(sizeof(Feedback), 1);
 
-	feedback->trigger = NULL;
-	feedback->data = NULL;
-
-	feedback->stage = 0;
 	feedback->stages = 1;
-	feedback->remove_qr = 0;
 	feedback->description = buffer_new(0);
 	
 	return feedback;
@@ -173,9 +193,10 @@ char const * feedback_get_description(Feedback const * const feedback) {
 void feedback_reset(Feedback * feedback, int stages) {
 	feedback->stage = 0;
 	feedback->stages = stages;
+	__atomic_store_n(& feedback->pending, 0, __ATOMIC_RELEASE);
 	buffer_clear(feedback->description);
-	buffer_append_string(feedback->description, "Initialising");
-	buffer_append(feedback->description, "\0", 1);
+	// Append the description and its NUL terminator in one go
+	buffer_append(feedback->description, "Initialising", sizeof("Initialising"));
 }
 
 /**
@@ -195,8 +216,15 @@ bool feedback_next_stage(Feedback * feedback, char const * const description) {
 	result = true;
 	feedback->stage++;
 	buffer_clear(feedback->description);
-	buffer_append_string(feedback->description, description);
-	buffer_append(feedback->description, "\0", 1);
+	// Append the description and its NUL terminator in one go
+	buffer_append(feedback->description, description, strlen(description) + 1);
+
+	// Publish the stage transition for polling consumers; a single atomic
+	// or, no call or branch in the no-subscriber case
+	if (feedback->stage < 32) {
+		__atomic_fetch_or(& feedback->pending, ((uint32_t)1) << feedback->stage, __ATOMIC_RELEASE);
+	}
+
 	if (feedback->trigger != NULL) {
 		result = feedback->trigger(feedback, feedback->data);
 	}
@@ -204,6 +232,24 @@ bool feedback_next_stage(Feedback * feedback, char const * const description) {
 	return result;
 }
 
+/**
+ * Return and clear the set of stage-transition events that have occurred
+ * since the last call. Bit n of the result is set if stage n has been
+ * entered in the meantime.
+ *
+ * This is the polling alternative to feedback_set_trigger(): rather than
+ * having the protocol call back synchronously on every transition, a
+ * consumer can collect the pending events from its own event loop. The
+ * exchange is atomic, so the producer and consumer may run on different
+ * threads.
+ *
+ * @param feedback The feedback object to get the events from.
+ * @return A bitmask of the stages entered since the previous call.
+ */
+uint32_t feedback_consume_events(Feedback * feedback) {
+	return __atomic_exchange_n(& feedback->pending, 0, __ATOMIC_ACQ_REL);
+}
+
 /**
  * Set the stage at which the QR code will be removed. This will be set to 0 if
  * unless set explicitly.
@@ -72,6 +72,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
 //#include <malloc.h>
 #include "pico/debug.h"
 #include "pico/log.h"
@@ -88,30 +90,13 @@
 
 #define RECONNECT_DELAY (10000)
 #define CONTAUTH_LEEWAY (1000)
+// Initial size of the buffer incoming network data is staged into; sized to
+// cover the largest sigma protocol message so the common case never grows it
+#define READ_BUFFER_SIZE (4096)
 #define MAX(x,y) ((x) > (y) ? (x) : (y))
 
 // Structure definitions
 
-/**
- * @brief Pico finite state machine callbacks
- *
- * Provides a strucure for storing the callbacks (virtual functions) used
- * to tie an external communication provider to the state machine.
- *
- * In practice these functions should be set using fsmpico_set_functions()
- *
- */
-typedef struct _AuthFsmComms {
-	FsmWrite write;
-	FsmSetTimeout setTimeout;
-	FsmError error;
-	FsmReconnect reconnect;
-	FsmDisconnect disconnect;
-	FsmAuthenticated authenticated;
-	FsmSessionEnded sessionEnded;
-	FsmStatusUpdate statusUpdate;
-} AuthFsmComms;
-
 /**
  * @brief Pico finite state machine internal data
  *
@@ -128,8 +113,19 @@ struct _FsmPico {
 	Buffer * extraData;
 
 	FSMPICOSTATE state;
-	AuthFsmComms * comms;
+	FsmCallbacks * comms;
 	void * user_data;
+	// Fixed staging buffer reused by fsmpico_read, so accepting data from
+	// the network doesn't allocate per event
+	Buffer * readBuffer;
+	// Scratch buffers reused across events for message construction and
+	// extra data, following the same pattern as readBuffer; the event
+	// handlers run to completion one at a time, so a single pair suffices
+	Buffer * scratchMessage;
+	Buffer * scratchExtra;
+	// Absolute monotonic time in milliseconds at which the most recently
+	// requested timeout falls due; zero when no timeout is pending
+	uint64_t deadline;
 };
 
 // Function prototypes
@@ -141,6 +137,7 @@ static bool readMessageStatus(FsmPico * fsmpico, Buffer const * message, Buffer
 static void createMessagePicoReauth(FsmPico * fsmpico, Buffer * message, Buffer const * sendExtraData);
 static bool readMessageServiceReauth(FsmPico * fsmpico, Buffer const * message, int * timeout);
 static void stateTransition(FsmPico* fsmpico, FSMPICOSTATE newState);
+static void requestTimeout(FsmPico * fsmpico, int timeout);
 
 static void FsmWriteNull(char const * data, size_t length, void * user_data);
 static void FsmSetTimeoutNull(int timeout, void * user_data);
@@ -172,8 +169,11 @@ FsmPico * fsmpico_new() {
 	fsmpico->sharedKey = buffer_new(0);
 
 	fsmpico->state = FSMPICOSTATE_INVALID;
+	fsmpico->readBuffer = buffer_new(READ_BUFFER_SIZE);
+	fsmpico->scratchMessage = buffer_new(0);
+	fsmpico->scratchExtra = buffer_new(0);
 
-	fsmpico->comms = CALLOC(sizeof(AuthFsmComms), 1);
+	fsmpico->comms = CALLOC(sizeof(FsmCallbacks), 1);
 
 	fsmpico->comms->write = FsmWriteNull;
 	fsmpico->comms->setTimeout = FsmSetTimeoutNull;
@@ -213,7 +213,22 @@ void fsmpico_delete(FsmPico * fsmpico) {
 			buffer_delete(fsmpico->sharedKey);
 			fsmpico->sharedKey = NULL;
 		}
-		
+
+		if (fsmpico->readBuffer) {
+			buffer_delete(fsmpico->readBuffer);
+			fsmpico->readBuffer = NULL;
+		}
+
+		if (fsmpico->scratchMessage) {
+			buffer_delete(fsmpico->scratchMessage);
+			fsmpico->scratchMessage = NULL;
+		}
+
+		if (fsmpico->scratchExtra) {
+			buffer_delete(fsmpico->scratchExtra);
+			fsmpico->scratchExtra = NULL;
+		}
+
 		FREE(fsmpico->comms);
 
 		FREE(fsmpico);
@@ -369,9 +384,14 @@ void fsmpico_read(FsmPico * fsmpico, char const * data, size_t length) {
 	Buffer * dataread;
 	char status;
     
-	receivedExtraData = buffer_new(0);
-	message = buffer_new(0);
-	dataread = buffer_new(length);
+	// Use the per-instance scratch buffers; clearing resets the position
+	// without releasing the storage, so repeat reads stay off the allocator
+	receivedExtraData = fsmpico->scratchExtra;
+	buffer_clear(receivedExtraData);
+	message = fsmpico->scratchMessage;
+	buffer_clear(message);
+	dataread = fsmpico->readBuffer;
+	buffer_clear(dataread);
 	buffer_append(dataread, data, length);
 
 	// TODO: If the reads fail, should move to an error state
@@ -412,10 +432,10 @@ void fsmpico_read(FsmPico * fsmpico, char const * data, size_t length) {
 			LOG(LOG_DEBUG, "Timeout set to: %d", timeout);
 			// Wait for timeout
 			if (fsmpico->currentState != REAUTHSTATE_STOP) {
-				fsmpico->comms->setTimeout(MAX((timeout - CONTAUTH_LEEWAY), 1), fsmpico->user_data);
+				requestTimeout(fsmpico, MAX((timeout - CONTAUTH_LEEWAY), 1));
 			}
 			else {
-				fsmpico->comms->setTimeout(1, fsmpico->user_data);
+				requestTimeout(fsmpico, 1);
 			}
 		}
 		break;
@@ -424,10 +444,6 @@ void fsmpico_read(FsmPico * fsmpico, char const * data, size_t length) {
 		fsmpico->comms->error(fsmpico->user_data);
 		break;
 	}
-
-	buffer_delete(receivedExtraData);
-	buffer_delete(message);
-	buffer_delete(dataread);
 }
 
 /**
@@ -441,8 +457,10 @@ void fsmpico_connected(FsmPico * fsmpico) {
 
 	LOG(LOG_DEBUG, "Connected");
 
-	extraData = buffer_new(0);
-	message = buffer_new(0);
+	extraData = fsmpico->scratchExtra;
+	buffer_clear(extraData);
+	message = fsmpico->scratchMessage;
+	buffer_clear(message);
 
 	switch (fsmpico->state) {
 	case FSMPICOSTATE_START:
@@ -464,9 +482,6 @@ void fsmpico_connected(FsmPico * fsmpico) {
 		fsmpico->comms->error(fsmpico->user_data);
 		break;
 	}
-
-	buffer_delete(extraData);
-	buffer_delete(message);
 }
 
 /**
@@ -482,7 +497,7 @@ void fsmpico_disconnected(FsmPico * fsmpico) {
 	case FSMPICOSTATE_AUTHENTICATED:
 		stateTransition(fsmpico, FSMPICOSTATE_CONTSTARTPICO);
 		// Wait for a second
-		fsmpico->comms->setTimeout(RECONNECT_DELAY, fsmpico->user_data);
+		requestTimeout(fsmpico, RECONNECT_DELAY);
 		break;
 	case FSMPICOSTATE_CONTSTARTPICO:
 	case FSMPICOSTATE_CONTSTARTSERVICE:
@@ -509,8 +524,13 @@ void fsmpico_timeout(FsmPico * fsmpico) {
 
 	LOG(LOG_DEBUG, "Timeout");
 
-	extraData = buffer_new(0);
-	message = buffer_new(0);
+	// The pending timeout has fired; any handler below may request another
+	fsmpico->deadline = 0;
+
+	extraData = fsmpico->scratchExtra;
+	buffer_clear(extraData);
+	message = fsmpico->scratchMessage;
+	buffer_clear(message);
 
 	switch (fsmpico->state) {
 		case FSMPICOSTATE_CONTSTARTPICO:
@@ -526,15 +546,12 @@ void fsmpico_timeout(FsmPico * fsmpico) {
 		LOG(LOG_DEBUG, "Timer fired during an invalid state");
 		break;
 	}
-
-	buffer_delete(extraData);
-	buffer_delete(message);
 }
 
 void fsmpico_sendstop(FsmPico * fsmpico) {
 	fsmpico->currentState = REAUTHSTATE_STOP;
 	if (fsmpico->state == FSMPICOSTATE_PICOREAUTH) {
-		fsmpico->comms->setTimeout(1, fsmpico->user_data);
+		requestTimeout(fsmpico, 1);
 	}
 }
 
@@ -543,6 +560,24 @@ void stateTransition(FsmPico* fsmpico, FSMPICOSTATE newState) {
 	fsmpico->comms->statusUpdate(newState, fsmpico->user_data);
 }
 
+/**
+ * An internal function used to request a timeout from the communication
+ * provider. Only one timeout is ever in play, so the absolute deadline is
+ * recorded before the setTimeout callback fires; a caller multiplexing many
+ * state machines over a single timer can read it back with
+ * fsmpico_get_deadline() rather than arming a timer per request.
+ *
+ * @param fsmpico The object to apply to.
+ * @param timeout The timeout period in milliseconds.
+ */
+static void requestTimeout(FsmPico * fsmpico, int timeout) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, & now);
+	fsmpico->deadline = (((uint64_t)now.tv_sec) * 1000) + (now.tv_nsec / 1000000) + timeout;
+	fsmpico->comms->setTimeout(timeout, fsmpico->user_data);
+}
+
 /**
  * An internal function used to construct a MessageStart data item.
  *
@@ -769,4 +804,18 @@ FSMPICOSTATE fsmpico_get_state(FsmPico * fsmpico) {
     return fsmpico->state;
 }
 
+/**
+ * Return the absolute monotonic time, in milliseconds, at which the most
+ * recently requested timeout falls due, or zero if no timeout has been
+ * requested. A caller running many state machines can key a min-heap on
+ * these deadlines and service them all from one timer armed for the
+ * earliest one, instead of arming a timer per setTimeout callback.
+ *
+ * @param fsmpico The object to apply to.
+ * @return The pending deadline in milliseconds on the CLOCK_MONOTONIC clock.
+ */
+uint64_t fsmpico_get_deadline(FsmPico * fsmpico) {
+	return fsmpico->deadline;
+}
+
 /** @} addtogroup Protocol */
@@ -76,6 +76,8 @@
 #include <stdlib.h>
 //#include <malloc.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
 #include "pico/debug.h"
 #include "pico/log.h"
 #include "pico/shared.h"
@@ -95,27 +97,15 @@
 #define RECONNECT_DELAY (10000)
 #define AUTHENTICATION_TIME_LIMIT (5000)
 
-// Structure definitions
+// Bits of cb_mask recording which of the optional callbacks were actually
+// registered, so transitions can skip the indirect call to a dummy function
+// when the developer didn't ask for the notification
+#define FSMSERVICE_CB_ERROR (1 << 0)
+#define FSMSERVICE_CB_AUTHENTICATED (1 << 1)
+#define FSMSERVICE_CB_SESSIONENDED (1 << 2)
+#define FSMSERVICE_CB_STATUSUPDATE (1 << 3)
 
-/**
- * @brief Pico finite state machine callbacks
- *
- * Provides a strucure for storing the callbacks (virtual functions) used
- * to tie an external communication provider to the state machine.
- *
- * In practice these functions should be set using fsmservice_set_functions()
- *
- */
-typedef struct _AuthFsmServiceComms {
-	FsmWrite write;
-	FsmSetTimeout setTimeout;
-	FsmError error;
-	FsmListen listen;
-	FsmDisconnect disconnect;
-	FsmAuthenticated authenticated;
-	FsmSessionEnded sessionEnded;
-	FsmStatusUpdate statusUpdate;
-} AuthFsmServiceComms;
+// Structure definitions
 
 /**
  * @brief Pico finite state machine internal data
@@ -125,17 +115,24 @@ typedef struct _AuthFsmServiceComms {
  *
  */
 struct _FsmService {
+	// Hot fields, read on every tick by a host scanning many sessions,
+	// kept together at the front of the structure so the scan touches a
+	// single cache line per session; the Buffers and protocol state below
+	// are only needed on an actual transition
+	FSMSERVICESTATE state;
+	uint64_t deadline;
+	void * user_data;
+	int currentTimeout;
 	REAUTHSTATE currentState;
+	uint8_t cb_mask;
+
 	SequenceNumber * picoSeqNumber;
 	SequenceNumber * serviceSeqNumber;
 	Buffer * sharedKey;
 	Shared * shared;
 	Buffer * extraData;
 	Buffer * returnedExtraData;
-	int currentTimeout;
-	FSMSERVICESTATE state;
-	AuthFsmServiceComms * comms;
-	void * user_data;
+	FsmCallbacks * comms;
 	Users const * users;
 	Buffer * user;
 	Buffer * symmetrickey;
@@ -151,6 +148,11 @@ static void createMessageStatus(FsmService * fsmservice, Buffer * message, Buffe
 static bool readMessagePicoReauth(FsmService * fsmservice, Buffer /* const */ * message, Buffer * returnedExtraData);
 static void createMessageServiceReauth(FsmService * fsmservice, Buffer * message, int timeout);
 static bool fsmservice_check_user(FsmService * fsmservice, Buffer * user, Buffer * symmetrickey);
+static void requestTimeout(FsmService * fsmservice, int timeout);
+static void emitStatusUpdate(FsmService * fsmservice);
+static void emitError(FsmService * fsmservice);
+static void emitAuthenticated(FsmService * fsmservice, int status);
+static void emitSessionEnded(FsmService * fsmservice);
 
 static void FsmWriteNull(char const * data, size_t length, void * user_data);
 static void FsmSetTimeoutNull(int timeout, void * user_data);
@@ -189,7 +191,9 @@ FsmService * fsmservice_new() {
 	fsmservice->symmetrickey = buffer_new(0);
 	fsmservice->continuous = false;
 
-	fsmservice->comms = CALLOC(sizeof(AuthFsmServiceComms), 1);
+	fsmservice->cb_mask = 0;
+
+	fsmservice->comms = CALLOC(sizeof(FsmCallbacks), 1);
 
 	fsmservice->comms->write = FsmWriteNull;
 	fsmservice->comms->setTimeout = FsmSetTimeoutNull;
@@ -282,6 +286,71 @@ void fsmservice_set_functions(FsmService * fsmservice, FsmWrite write, FsmSetTim
 	fsmservice->comms->authenticated = authenticated ? authenticated : FsmAuthenticatedNull;
 	fsmservice->comms->sessionEnded = sessionEnded ? sessionEnded : FsmSessionEndedNull;
 	fsmservice->comms->statusUpdate = statusUpdate ? statusUpdate : FsmStatusUpdateNull;
+
+	fsmservice->cb_mask = 0;
+	if (error) {
+		fsmservice->cb_mask |= FSMSERVICE_CB_ERROR;
+	}
+	if (authenticated) {
+		fsmservice->cb_mask |= FSMSERVICE_CB_AUTHENTICATED;
+	}
+	if (sessionEnded) {
+		fsmservice->cb_mask |= FSMSERVICE_CB_SESSIONENDED;
+	}
+	if (statusUpdate) {
+		fsmservice->cb_mask |= FSMSERVICE_CB_STATUSUPDATE;
+	}
+}
+
+/**
+ * Notify the developer of a state change, if and only if a statusUpdate
+ * callback was registered. Checking the mask first replaces an indirect
+ * call to a dummy function on every transition with a single predictable
+ * branch.
+ *
+ * @param fsmservice The object to apply to.
+ */
+static void emitStatusUpdate(FsmService * fsmservice) {
+	if ((fsmservice->cb_mask & FSMSERVICE_CB_STATUSUPDATE) != 0) {
+		fsmservice->comms->statusUpdate(fsmservice->state, fsmservice->user_data);
+	}
+}
+
+/**
+ * Notify the developer that an error occurred, if and only if an error
+ * callback was registered.
+ *
+ * @param fsmservice The object to apply to.
+ */
+static void emitError(FsmService * fsmservice) {
+	if ((fsmservice->cb_mask & FSMSERVICE_CB_ERROR) != 0) {
+		fsmservice->comms->error(fsmservice->user_data);
+	}
+}
+
+/**
+ * Notify the developer that authentication completed, if and only if an
+ * authenticated callback was registered.
+ *
+ * @param fsmservice The object to apply to.
+ * @param status The authentication outcome, one of the MESSAGESTATUS codes.
+ */
+static void emitAuthenticated(FsmService * fsmservice, int status) {
+	if ((fsmservice->cb_mask & FSMSERVICE_CB_AUTHENTICATED) != 0) {
+		fsmservice->comms->authenticated(status, fsmservice->user_data);
+	}
+}
+
+/**
+ * Notify the developer that the continuous authentication session ended,
+ * if and only if a sessionEnded callback was registered.
+ *
+ * @param fsmservice The object to apply to.
+ */
+static void emitSessionEnded(FsmService * fsmservice) {
+	if ((fsmservice->cb_mask & FSMSERVICE_CB_SESSIONENDED) != 0) {
+		fsmservice->comms->sessionEnded(fsmservice->user_data);
+	}
 }
 
 /**
@@ -319,6 +388,24 @@ static void FsmSetTimeoutNull(int timeout, void * user_data) {
 	LOG(LOG_DEBUG, "FsmiPico SetTimeout function not set");
 }
 
+/**
+ * An internal function used to request a timeout from the communication
+ * provider. Only one timeout is ever in play, so the absolute deadline is
+ * recorded before the setTimeout callback fires; a server multiplexing many
+ * state machines over a single timer can read it back with
+ * fsmservice_get_deadline() rather than arming a timer per request.
+ *
+ * @param fsmservice The object to apply to.
+ * @param timeout The timeout period in milliseconds.
+ */
+static void requestTimeout(FsmService * fsmservice, int timeout) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, & now);
+	fsmservice->deadline = (((uint64_t)now.tv_sec) * 1000) + (now.tv_nsec / 1000000) + timeout;
+	fsmservice->comms->setTimeout(timeout, fsmservice->user_data);
+}
+
 /**
  * The default (dummy) function used as an error callback if the user
  * doesn't specify an alternative.
@@ -405,26 +492,26 @@ void fsmservice_read(FsmService * fsmservice, char const * data, size_t length)
 		LOG(LOG_DEBUG, "Result %d", result);
 		if (result) {
 			fsmservice->state = FSMSERVICESTATE_SERVICEAUTH;
-			fsmservice->comms->statusUpdate(fsmservice->state, fsmservice->user_data);
+			emitStatusUpdate(fsmservice);
 			createMessageServiceAuth(fsmservice, message);
 
 			LOG(LOG_DEBUG, "About to write");
 			fsmservice->comms->write(buffer_get_buffer(message), buffer_get_pos(message), fsmservice->user_data);
 			LOG(LOG_DEBUG, "Written");
 			fsmservice->state = FSMSERVICESTATE_PICOAUTH;
-			fsmservice->comms->statusUpdate(fsmservice->state, fsmservice->user_data);
+			emitStatusUpdate(fsmservice);
 		}
 		else {
 			LOG(LOG_ERR, "Error decoding start message");
 			fsmservice->state = FSMSERVICESTATE_ERROR;
-			fsmservice->comms->error(fsmservice->user_data);
+			emitError(fsmservice);
 		}
 		break;
 	case FSMSERVICESTATE_PICOAUTH:
 		result = readMessagePicoAuth(fsmservice, dataread, fsmservice->returnedExtraData);
 		if (result) {
 			fsmservice->state = FSMSERVICESTATE_STATUS;
-			fsmservice->comms->statusUpdate(fsmservice->state, fsmservice->user_data);
+			emitStatusUpdate(fsmservice);
 			result = fsmservice_check_user(fsmservice, fsmservice->user, fsmservice->symmetrickey);
 			// Status is set to:
 			// MESSAGESTATUS_OK_CONTINUE if auth succeeded and continuous is true
@@ -449,12 +536,12 @@ void fsmservice_read(FsmService * fsmservice, char const * data, size_t length)
 		}
 		if (result) {
 			fsmservice->state = FSMSERVICESTATE_AUTHENTICATED;
-			fsmservice->comms->statusUpdate(fsmservice->state, fsmservice->user_data);
+			emitStatusUpdate(fsmservice);
 			fsmservice->comms->disconnect(fsmservice->user_data);
 		}
 		else {
 			fsmservice->state = FSMSERVICESTATE_AUTHFAILED;
-			fsmservice->comms->statusUpdate(fsmservice->state, fsmservice->user_data);
+			emitStatusUpdate(fsmservice);
 			fsmservice->comms->disconnect(fsmservice->user_data);
 		}
 		break;
@@ -463,17 +550,17 @@ void fsmservice_read(FsmService * fsmservice, char const * data, size_t length)
 		result = readMessagePicoReauth(fsmservice, dataread, fsmservice->returnedExtraData);
 		if (result) {
 			fsmservice->state = FSMSERVICESTATE_SERVICEREAUTH;
-			fsmservice->comms->statusUpdate(fsmservice->state, fsmservice->user_data);
+			emitStatusUpdate(fsmservice);
 		}
 		else {
 			LOG(LOG_ERR, "Error decoding Pico reauth message");
 			fsmservice->state = FSMSERVICESTATE_ERROR;
-			fsmservice->comms->error(fsmservice->user_data);
+			emitError(fsmservice);
 		}
 		break;
 	default:
 		fsmservice->state = FSMSERVICESTATE_ERROR;
-		fsmservice->comms->error(fsmservice->user_data);
+		emitError(fsmservice);
 		break;
 	}
 
@@ -496,9 +583,9 @@ void fsmservice_connected(FsmService * fsmservice) {
 	switch (fsmservice->state) {
 	case FSMSERVICESTATE_CONNECT:
 		fsmservice->state = FSMSERVICESTATE_START;
-		fsmservice->comms->statusUpdate(fsmservice->state, fsmservice->user_data);
+		emitStatusUpdate(fsmservice);
 		// Set a timer; authentication must complete within this time
-		fsmservice->comms->setTimeout(AUTHENTICATION_TIME_LIMIT, fsmservice->user_data);
+		requestTimeout(fsmservice, AUTHENTICATION_TIME_LIMIT);
 		break;
 	case FSMSERVICESTATE_CONTSTARTSERVICE:
 		fsmservice->currentState = REAUTHSTATE_CONTINUE;
@@ -507,12 +594,12 @@ void fsmservice_connected(FsmService * fsmservice) {
 		sequencenumber_random(fsmservice->serviceSeqNumber);
 
 		fsmservice->state = FSMSERVICESTATE_CONTSTARTPICO;
-		fsmservice->comms->statusUpdate(fsmservice->state, fsmservice->user_data);
-		fsmservice->comms->setTimeout((fsmservice->currentTimeout), fsmservice->user_data);
+		emitStatusUpdate(fsmservice);
+		requestTimeout(fsmservice, fsmservice->currentTimeout);
 		break;
 	default:
 		fsmservice->state = FSMSERVICESTATE_ERROR;
-		fsmservice->comms->error(fsmservice->user_data);
+		emitError(fsmservice);
 		break;
 	}
 
@@ -531,27 +618,27 @@ void fsmservice_disconnected(FsmService * fsmservice) {
 	switch (fsmservice->state) {
 	case FSMSERVICESTATE_AUTHENTICATED:
 		if (fsmservice->continuous) {
-			fsmservice->comms->authenticated(MESSAGESTATUS_OK_CONTINUE, fsmservice->user_data);
+			emitAuthenticated(fsmservice, MESSAGESTATUS_OK_CONTINUE);
 			fsmservice->state = FSMSERVICESTATE_CONTSTARTSERVICE;
-			fsmservice->comms->statusUpdate(fsmservice->state, fsmservice->user_data);
+			emitStatusUpdate(fsmservice);
 			fsmservice->comms->listen(fsmservice->user_data);
-			fsmservice->comms->setTimeout((RECONNECT_DELAY + fsmservice->currentTimeout), fsmservice->user_data);
+			requestTimeout(fsmservice, RECONNECT_DELAY + fsmservice->currentTimeout);
 		}
 		else {
-			fsmservice->comms->authenticated(MESSAGESTATUS_OK_DONE, fsmservice->user_data);
+			emitAuthenticated(fsmservice, MESSAGESTATUS_OK_DONE);
 		}
 		break;
 	case FSMSERVICESTATE_AUTHFAILED:
-		fsmservice->comms->authenticated(MESSAGESTATUS_REJECTED, fsmservice->user_data);
+		emitAuthenticated(fsmservice, MESSAGESTATUS_REJECTED);
 		break;
 	case FSMSERVICESTATE_CONTSTARTPICO:
 	case FSMSERVICESTATE_CONTSTARTSERVICE:
 		fsmservice->state = FSMSERVICESTATE_FIN;
-		fsmservice->comms->sessionEnded(fsmservice->user_data);
+		emitSessionEnded(fsmservice);
 		break;
 	default:
 		fsmservice->state = FSMSERVICESTATE_ERROR;
-		fsmservice->comms->error(fsmservice->user_data);
+		emitError(fsmservice);
 		break;
 	}
 }
@@ -567,24 +654,25 @@ void fsmservice_timeout(FsmService * fsmservice) {
 
 	LOG(LOG_DEBUG, "Timeout");
 
+	fsmservice->deadline = 0;
 	message = buffer_new(0);
 
 	switch (fsmservice->state) {
 	case FSMSERVICESTATE_CONTSTARTSERVICE:
 		fsmservice->state = FSMSERVICESTATE_FIN;
-		fsmservice->comms->sessionEnded(fsmservice->user_data);
+		emitSessionEnded(fsmservice);
 		break;
 	case FSMSERVICESTATE_CONTSTARTPICO:
 	case FSMSERVICESTATE_PICOREAUTH:
 		fsmservice->state = FSMSERVICESTATE_FIN;
-		fsmservice->comms->sessionEnded(fsmservice->user_data);
+		emitSessionEnded(fsmservice);
 		break;
 	case FSMSERVICESTATE_SERVICEREAUTH:
 		createMessageServiceReauth(fsmservice, message, fsmservice->currentTimeout);
 		fsmservice->comms->write(buffer_get_buffer(message), buffer_get_pos(message), fsmservice->user_data);
 		fsmservice->state = FSMSERVICESTATE_PICOREAUTH;
-		fsmservice->comms->statusUpdate(fsmservice->state, fsmservice->user_data);
-		fsmservice->comms->setTimeout(fsmservice->currentTimeout, fsmservice->user_data);
+		emitStatusUpdate(fsmservice);
+		requestTimeout(fsmservice, fsmservice->currentTimeout);
 		break;
 	case FSMSERVICESTATE_AUTHENTICATED:
 	case FSMSERVICESTATE_AUTHFAILED:
@@ -594,7 +682,7 @@ void fsmservice_timeout(FsmService * fsmservice) {
 	default:
 		LOG(LOG_DEBUG, "Login took too long");
 		fsmservice->state = FSMSERVICESTATE_ERROR;
-		fsmservice->comms->error(fsmservice->user_data);
+		emitError(fsmservice);
 		break;
 	}
 
@@ -749,7 +837,7 @@ static bool readMessagePicoReauth(FsmService * fsmservice, Buffer * message, Buf
 		buffer_append_buffer(returnedExtraData, extraData);
 	} else {
 		fsmservice->currentState = REAUTHSTATE_ERROR;
-		fsmservice->comms->error(fsmservice->user_data);
+		emitError(fsmservice);
 	}
 
 	messagepicoreauth_delete(messagepicoreauth);
@@ -863,7 +951,7 @@ void fsmservice_start(FsmService * fsmservice, Shared * shared, Users const * us
 
 	// Establish the starting state
 	fsmservice->state = FSMSERVICESTATE_CONNECT;
-	fsmservice->comms->statusUpdate(fsmservice->state, fsmservice->user_data);
+	emitStatusUpdate(fsmservice);
 }
 
 /**
@@ -886,9 +974,9 @@ void fsmservice_stop(FsmService * fsmservice) {
 	case FSMSERVICESTATE_STATUS:
 		// Jump to the auth failed state
 		fsmservice->state = FSMSERVICESTATE_AUTHFAILED;
-		fsmservice->comms->statusUpdate(fsmservice->state, fsmservice->user_data);
+		emitStatusUpdate(fsmservice);
 		// Authentication failed
-		fsmservice->comms->authenticated(MESSAGESTATUS_REJECTED, fsmservice->user_data);
+		emitAuthenticated(fsmservice, MESSAGESTATUS_REJECTED);
 		break;
 	case FSMSERVICESTATE_AUTHENTICATED:
 	case FSMSERVICESTATE_AUTHFAILED:
@@ -900,9 +988,9 @@ void fsmservice_stop(FsmService * fsmservice) {
 	case FSMSERVICESTATE_SERVICEREAUTH:
 		// Jump to fin
 		fsmservice->state = FSMSERVICESTATE_FIN;
-		fsmservice->comms->statusUpdate(fsmservice->state, fsmservice->user_data);
+		emitStatusUpdate(fsmservice);
 		// Session ended
-		fsmservice->comms->sessionEnded(fsmservice->user_data);
+		emitSessionEnded(fsmservice);
 		break;
 	case FSMSERVICESTATE_FIN:
 	case FSMSERVICESTATE_ERROR:
@@ -928,6 +1016,21 @@ FSMSERVICESTATE fsmservice_get_state(FsmService * fsmservice) {
 	return fsmservice->state;
 }
 
+/**
+ * Return the absolute monotonic time, in milliseconds, at which the most
+ * recently requested timeout falls due, or zero if no timeout has been
+ * requested. A server handling many simultaneous sessions can keep these
+ * deadlines in a packed array or min-heap of its own, scan that on each
+ * tick and service every session from one timer armed for the earliest
+ * deadline, instead of arming a timer per setTimeout callback.
+ *
+ * @param fsmservice The object to apply to.
+ * @return The pending deadline in milliseconds on the CLOCK_MONOTONIC clock.
+ */
+uint64_t fsmservice_get_deadline(FsmService * fsmservice) {
+	return fsmservice->deadline;
+}
+
 /**
  * Get the user that authenticated. The value is only valid after the
  * state machine has reached the FSMSERVICESTATE_STATUS state and the
@@ -943,6 +1046,26 @@ Buffer const * fsmservice_get_user(FsmService * fsmservice) {
 	return fsmservice->user;
 }
 
+/**
+ * Borrow the name of the user that authenticated as a pointer-and-length
+ * span over the state machine's internal storage. This avoids the caller
+ * copying the bytes out of the Buffer returned by fsmservice_get_user()
+ * into its own allocation.
+ *
+ * The span remains valid until the next call to fsmservice_stop() or
+ * fsmservice_delete(); callers wanting the data beyond that must copy it.
+ * The value is only meaningful under the same conditions as
+ * fsmservice_get_user().
+ *
+ * @param fsmservice The object to get the data from.
+ * @param data Out parameter set to the start of the user name bytes.
+ * @param length Out parameter set to the number of bytes in the name.
+ */
+void fsmservice_borrow_user(FsmService * fsmservice, uint8_t const ** data, size_t * length) {
+	*data = (uint8_t const *)buffer_get_buffer(fsmservice->user);
+	*length = buffer_get_pos(fsmservice->user);
+}
+
 /**
  * Get the symmetric key stored for the authenticatd user. The value is
  * only valid after the state machine has reached the
@@ -959,6 +1082,21 @@ Buffer const * fsmservice_get_symmetric_key(FsmService * fsmservice) {
 	return fsmservice->symmetrickey;
 }
 
+/**
+ * Borrow the symmetric key stored for the authenticated user as a
+ * pointer-and-length span over the state machine's internal storage. See
+ * fsmservice_borrow_user() for the lifetime rules; the value is only
+ * meaningful under the same conditions as fsmservice_get_symmetric_key().
+ *
+ * @param fsmservice The object to get the data from.
+ * @param data Out parameter set to the start of the key bytes.
+ * @param length Out parameter set to the number of bytes in the key.
+ */
+void fsmservice_borrow_symmetric_key(FsmService * fsmservice, uint8_t const ** data, size_t * length) {
+	*data = (uint8_t const *)buffer_get_buffer(fsmservice->symmetrickey);
+	*length = buffer_get_pos(fsmservice->symmetrickey);
+}
+
 /**
  * Set whether the FSM should perform continuous authentication or not. If set
  * to true, once a Pico has authenticated the service will attempt to perform
@@ -1001,6 +1139,24 @@ Buffer const * fsmservice_get_received_extra_data(FsmService * fsmservice) {
 	return fsmservice->returnedExtraData;
 }
 
+/**
+ * Borrow the latest extra data sent by the Pico as a pointer-and-length
+ * span over the state machine's internal storage. The update semantics
+ * are the same as for fsmservice_get_received_extra_data(); note in
+ * particular that the bytes are overwritten when the next PicoAuth or
+ * PicoReauth message arrives, as well as on fsmservice_stop(), so the
+ * span should be consumed from the statusUpdate callback that announced
+ * it or copied out.
+ *
+ * @param fsmservice The object to get the extra data from.
+ * @param data Out parameter set to the start of the extra data bytes.
+ * @param length Out parameter set to the number of bytes received.
+ */
+void fsmservice_borrow_received_extra_data(FsmService * fsmservice, uint8_t const ** data, size_t * length) {
+	*data = (uint8_t const *)buffer_get_buffer(fsmservice->returnedExtraData);
+	*length = buffer_get_pos(fsmservice->returnedExtraData);
+}
+
 /**
  *
  * Set the extra data that will be sent to the Pico. This is the same value
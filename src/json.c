@@ -349,6 +349,198 @@ bool json_deserialize_buffer(Json * json, Buffer const * buffer) {
 	return json_deserialize_string(json, buffer_get_buffer(buffer), buffer_get_pos(buffer));
 }
 
+/**
+ * Scan a JSON string in a single pass, firing the callback once for each
+ * top-level key-value pair in the order the pairs appear. Unlike
+ * json_deserialize_string(), nothing is allocated and no Json structure is
+ * built: the callback receives pointers into the input bounding the raw
+ * key and value text, which for strings means any escape sequences are
+ * left as they appear in the input. This suits the message deserializers,
+ * whose fixed schemas hold base64 and integer fields that never contain
+ * escapes and are decoded straight from the slice.
+ *
+ * Sublist values are reported whole, bounded by their outer braces, with
+ * the type set to JSONTYPE_SUBLIST; they can be scanned recursively if
+ * needed. Arrays are not supported, matching the deserializer.
+ *
+ * @param json_string The JSON string to scan; it does not need to be
+ *        null-terminated.
+ * @param length The length of the string to scan.
+ * @param callback Function fired for each top-level key-value pair.
+ * @param user_data Context pointer passed through to the callback.
+ * @return true if the input parsed cleanly or the callback stopped the
+ *         scan, false if the input was malformed.
+ */
+bool json_scan(char const * json_string, size_t length, JsonScanCallback callback, void * user_data) {
+	size_t pos;
+	size_t keystart;
+	size_t keylength;
+	size_t valuestart;
+	JSONTYPE type;
+	bool escaped;
+	bool decimal;
+	int depth;
+	char character;
+
+	pos = 0;
+	while ((pos < length) && ((json_string[pos] == ' ') || (json_string[pos] == '\t') || (json_string[pos] == '\n') || (json_string[pos] == '\r'))) {
+		pos++;
+	}
+	if ((pos >= length) || (json_string[pos] != '{')) {
+		return false;
+	}
+	pos++;
+
+	while (true) {
+		// Skip whitespace before the key or closing brace
+		while ((pos < length) && ((json_string[pos] == ' ') || (json_string[pos] == '\t') || (json_string[pos] == '\n') || (json_string[pos] == '\r'))) {
+			pos++;
+		}
+		if (pos >= length) {
+			return false;
+		}
+		if (json_string[pos] == '}') {
+			return true;
+		}
+		if (json_string[pos] != '"') {
+			return false;
+		}
+		pos++;
+
+		// Scan the key
+		keystart = pos;
+		escaped = false;
+		while ((pos < length) && (escaped || (json_string[pos] != '"'))) {
+			escaped = ((escaped == false) && (json_string[pos] == '\\'));
+			pos++;
+		}
+		if (pos >= length) {
+			return false;
+		}
+		keylength = pos - keystart;
+		pos++;
+
+		// Skip whitespace and the colon
+		while ((pos < length) && ((json_string[pos] == ' ') || (json_string[pos] == '\t') || (json_string[pos] == '\n') || (json_string[pos] == '\r'))) {
+			pos++;
+		}
+		if ((pos >= length) || (json_string[pos] != ':')) {
+			return false;
+		}
+		pos++;
+		while ((pos < length) && ((json_string[pos] == ' ') || (json_string[pos] == '\t') || (json_string[pos] == '\n') || (json_string[pos] == '\r'))) {
+			pos++;
+		}
+		if (pos >= length) {
+			return false;
+		}
+
+		// Scan the value
+		character = json_string[pos];
+		if (character == '"') {
+			pos++;
+			valuestart = pos;
+			escaped = false;
+			while ((pos < length) && (escaped || (json_string[pos] != '"'))) {
+				escaped = ((escaped == false) && (json_string[pos] == '\\'));
+				pos++;
+			}
+			if (pos >= length) {
+				return false;
+			}
+			type = JSONTYPE_STRING;
+			if (callback(json_string + keystart, keylength, type, json_string + valuestart, pos - valuestart, user_data) == false) {
+				return true;
+			}
+			pos++;
+		}
+		else if (character == '{') {
+			valuestart = pos;
+			depth = 0;
+			escaped = false;
+			// Balance the braces, ignoring any inside string values
+			while (pos < length) {
+				character = json_string[pos];
+				if (character == '{') {
+					depth++;
+				}
+				else if (character == '}') {
+					depth--;
+					if (depth == 0) {
+						break;
+					}
+				}
+				else if (character == '"') {
+					pos++;
+					escaped = false;
+					while ((pos < length) && (escaped || (json_string[pos] != '"'))) {
+						escaped = ((escaped == false) && (json_string[pos] == '\\'));
+						pos++;
+					}
+					if (pos >= length) {
+						return false;
+					}
+				}
+				pos++;
+			}
+			if (pos >= length) {
+				return false;
+			}
+			pos++;
+			type = JSONTYPE_SUBLIST;
+			if (callback(json_string + keystart, keylength, type, json_string + valuestart, pos - valuestart, user_data) == false) {
+				return true;
+			}
+		}
+		else {
+			valuestart = pos;
+			decimal = false;
+			while ((pos < length) && (json_string[pos] != ',') && (json_string[pos] != '}') && (json_string[pos] != ' ') && (json_string[pos] != '\t') && (json_string[pos] != '\n') && (json_string[pos] != '\r')) {
+				if ((json_string[pos] == '.') || (json_string[pos] == 'e') || (json_string[pos] == 'E')) {
+					decimal = true;
+				}
+				pos++;
+			}
+			if (pos == valuestart) {
+				return false;
+			}
+			type = decimal ? JSONTYPE_DECIMAL : JSONTYPE_INTEGER;
+			if (callback(json_string + keystart, keylength, type, json_string + valuestart, pos - valuestart, user_data) == false) {
+				return true;
+			}
+		}
+
+		// Skip whitespace before the separator or closing brace
+		while ((pos < length) && ((json_string[pos] == ' ') || (json_string[pos] == '\t') || (json_string[pos] == '\n') || (json_string[pos] == '\r'))) {
+			pos++;
+		}
+		if (pos >= length) {
+			return false;
+		}
+		if (json_string[pos] == '}') {
+			return true;
+		}
+		if (json_string[pos] != ',') {
+			return false;
+		}
+		pos++;
+	}
+}
+
+/**
+ * Scan JSON data held in a buffer in a single pass, firing the callback
+ * once for each top-level key-value pair. See json_scan() for the details.
+ *
+ * @param buffer The buffer containing the JSON data to scan.
+ * @param callback Function fired for each top-level key-value pair.
+ * @param user_data Context pointer passed through to the callback.
+ * @return true if the input parsed cleanly or the callback stopped the
+ *         scan, false if the input was malformed.
+ */
+bool json_scan_buffer(Buffer const * buffer, JsonScanCallback callback, void * user_data) {
+	return json_scan(buffer_get_buffer(buffer), buffer_get_pos(buffer), callback, user_data);
+}
+
 /**
  * Print out a serialization of the JSON data to stdout. Useful for debugging.
  *
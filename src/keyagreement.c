@@ -36,6 +36,14 @@
  * See the SigmaKeyDeriv class for details of the shared secret generation
  * process.
  *
+ * On the choice of curve: the protocol is pinned to NIST P-256
+ * (CRYPTOSUPPORT_ECCURVE) because the deployed Pico app expects it and
+ * the wire format carries keys as DER-encoded EC public keys, which
+ * cannot represent X25519. The derivation below is already expressed
+ * through the generic EVP_PKEY_derive interface, so a future curve
+ * migration only needs the key types and wire encoding versioned, not
+ * this code.
+ *
  */
 
 /** \addtogroup Crypto
@@ -47,6 +55,7 @@
 //#include <malloc.h>
 #include "pico/debug.h"
 #include "pico/log.h"
+#include "pico/cryptosupport.h"
 #include "pico/keyagreement.h"
 
 // Defines
@@ -73,17 +82,23 @@ void keyagreement_generate_secret(EVP_PKEY * vEphemPriv, EC_KEY * pEphemPub, Buf
 	ctx = EVP_PKEY_CTX_new(vEphemPriv, NULL);
 	EVP_PKEY_derive_init(ctx);
 
+	// Wrap the peer key without taking ownership, so the wrapper can be
+	// freed after the derivation while the caller keeps its EC_KEY
 	evpkey = EVP_PKEY_new();
-	EVP_PKEY_assign_EC_KEY(evpkey, pEphemPub);
+	EVP_PKEY_set1_EC_KEY(evpkey, pEphemPub);
 
 	EVP_PKEY_derive_set_peer(ctx, evpkey);
 
-	EVP_PKEY_derive(ctx, NULL, & sharedSecretLength);
+	// The secret length is fixed by the curve field size, so reserve it up
+	// front and derive in a single call rather than probing for the length
+	// with an extra derive round trip
+	sharedSecretLength = CRYPTOSUPPORT_ECCURVE_SIZE / 8;
 	buffer_set_min_size(sharedSecretOut, sharedSecretLength);
 
 	EVP_PKEY_derive(ctx, (unsigned char *)buffer_get_buffer(sharedSecretOut), & sharedSecretLength);
 	buffer_set_pos(sharedSecretOut, sharedSecretLength);
 
+	EVP_PKEY_free(evpkey);
 	EVP_PKEY_CTX_free(ctx);
 }
 
@@ -81,12 +81,34 @@
 struct _KeyAuth {
 	Json * json;
 	KeyPair * serviceIdentityKey;
+	// Serialized form, rebuilt lazily when the contents change; the JSON
+	// only changes through keyauth_set, so repeat serializations for the
+	// same QR code are plain copies from here
+	Buffer * serialized;
+	bool dirty;
 };
 
 // Function prototypes
 
+static void keyauth_refresh_serialized(KeyAuth * keyauth);
+
 // Function definitions
 
+/**
+ * An internal function that rebuilds the cached serialized form if the
+ * contents have changed since it was last built. All the serialization
+ * entry points copy from the cache, so the JSON tree is only walked once
+ * per change rather than once per QR code render.
+ *
+ * @param keyauth The object to refresh.
+ */
+static void keyauth_refresh_serialized(KeyAuth * keyauth) {
+	if (keyauth->dirty) {
+		json_serialize_buffer(keyauth->json, keyauth->serialized);
+		keyauth->dirty = false;
+	}
+}
+
 /**
  * Create a new instance of the class.
  *
@@ -97,6 +119,8 @@ KeyAuth * keyauth_new() {
 	
 	keyauth = CALLOC(sizeof(KeyAuth), 1);
 	keyauth->json = json_new();
+	keyauth->serialized = buffer_new(0);
+	keyauth->dirty = true;
 	
 	return keyauth;
 }
@@ -111,6 +135,9 @@ void keyauth_delete(KeyAuth * keyauth) {
 		if (keyauth->json) {
 			json_delete(keyauth->json);
 		}
+		if (keyauth->serialized) {
+			buffer_delete(keyauth->serialized);
+		}
 		// The serviceIdentityKey is now deleted when the Shared structure is deleted
 		//if (keyauth->serviceIdentityKey) {
 		//	keypair_delete(keyauth->serviceIdentityKey);
@@ -137,6 +164,7 @@ void keyauth_set(KeyAuth * keyauth, Buffer const * serviceAddress, char const *
 	EC_KEY * publickey;
 
 	keyauth->serviceIdentityKey = serviceIdentityKey;
+	keyauth->dirty = true;
 
 	json_add_string(keyauth->json, "t", "KA");
 	json_add_buffer(keyauth->json, "sa", serviceAddress);
@@ -189,14 +217,17 @@ void keyauth_log(KeyAuth * keyauth) {
  * @return The number of bytes required to store the JSON serialized key auth
  */
 size_t keyauth_serialize_size(KeyAuth * keyauth) {
-	return json_serialize_size(keyauth->json);
+	keyauth_refresh_serialized(keyauth);
+	return buffer_get_pos(keyauth->serialized);
 }
 
 /**
  * Serialize the key auth data in JSON format. The buffer should be
  * pre-allocated with enough space to store the required output. The size
  * required can be determined by calling keyauth_serialize_size().
- * The result won't be null-terminated.
+ * The result will be null-terminated as long as the buffer has space for
+ * the terminator after the serialized data (it always does if size is at
+ * least keyauth_serialize_size() + 1).
  * If the allocated buffer becomes full, no more bytes will be written and
  * the result will therefore by truncated.
  *
@@ -206,7 +237,40 @@ size_t keyauth_serialize_size(KeyAuth * keyauth) {
  * @return The number of bytes output
  */
 size_t keyauth_serialize(KeyAuth * keyauth, char * buffer, size_t size) {
-	return json_serialize(keyauth->json, buffer, size);
+	size_t length;
+
+	keyauth_refresh_serialized(keyauth);
+	length = buffer_get_pos(keyauth->serialized);
+	if (length > size) {
+		length = size;
+	}
+	memcpy(buffer, buffer_get_buffer(keyauth->serialized), length);
+	// Null-terminate when there's room for it; callers allocate size + 1
+	// bytes and pass the result on as a C string
+	if (length < size) {
+		buffer[length] = 0;
+	}
+
+	return length;
+}
+
+/**
+ * Serialize the key auth data in JSON format into a Buffer. The buffer will
+ * be resized as needed, so unlike keyauth_serialize() no separate sizing
+ * call or allocation is required; a caller that reuses the same buffer
+ * across serializations avoids allocating anything at all. The buffer
+ * contents are null-terminated.
+ *
+ * @param keyauth The object for serialization
+ * @param buffer Buffer to store the result in
+ * @return The number of bytes output
+ */
+size_t keyauth_serialize_into(KeyAuth * keyauth, Buffer * buffer) {
+	keyauth_refresh_serialized(keyauth);
+	buffer_clear(buffer);
+	buffer_append_buffer(buffer, keyauth->serialized);
+
+	return buffer_get_pos(buffer);
 }
 
 /** @} addtogroup Crypto */
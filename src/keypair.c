@@ -38,6 +38,7 @@
  */
 
 #include <stdio.h>
+#include <pthread.h>
 #include <openssl/ec.h>
 #include <openssl/obj_mac.h>
 #include <openssl/evp.h>
@@ -79,10 +80,17 @@
 struct _KeyPair {
 	EC_KEY * eckey;
 	EVP_PKEY * pkey;
+	// Digest context initialised for signing with pkey, built on the
+	// first keypair_sign_data call and copied per signature so the init
+	// cost is paid once per key rather than once per signature; cleared
+	// whenever the keys change
+	EVP_MD_CTX * signctx;
 };
 
 // Function prototypes
 
+static void keypair_group_init(void);
+
 EVP_PKEY * keypair_load_private_key(char const * file);
 EC_KEY * keypair_load_public_key(char const * file);
 
@@ -113,6 +121,53 @@ void keypair_delete(KeyPair * keypair) {
 	}
 }
 
+// The curve group shared by all key generations, built lazily on first use
+static EC_GROUP * keypair_group = NULL;
+static pthread_once_t keypair_group_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Cached digest context, reused across keypair_sign_data calls
+ *
+ * EVP_DigestSignInit re-keys the context in full on every call, so a
+ * single context per thread is safe to reuse and avoids an allocation
+ * and method lookup per signature. The context lives for the lifetime
+ * of the thread.
+ */
+static __thread EVP_MD_CTX * keypair_sign_mdctx = NULL;
+
+/**
+ * Internal function creating the shared curve group on first use. The curve
+ * is fixed by CRYPTOSUPPORT_ECCURVE at build time, so the group lookup, its
+ * encoding flags and the generator precomputation all happen once rather
+ * than on every key generation.
+ */
+static void keypair_group_init(void) {
+	keypair_group = EC_GROUP_new_by_curve_name(CRYPTOSUPPORT_ECCURVE);
+	if (keypair_group != NULL) {
+		EC_GROUP_set_asn1_flag(keypair_group, OPENSSL_EC_NAMED_CURVE);
+		EC_GROUP_set_point_conversion_form(keypair_group, POINT_CONVERSION_UNCOMPRESSED);
+		// Precompute multiples of the generator so key generation takes
+		// the fixed-base multiplication path
+		EC_GROUP_precompute_mult(keypair_group, NULL);
+	}
+}
+
+/**
+ * Return the shared curve group used for all of libpico's EC keys. The
+ * group is created once, flagged as a named curve and has its generator
+ * multiples precomputed, so operations on keys attached to it (signing,
+ * verification, key generation) take the fixed-base fast path rather
+ * than rebuilding tables per key. The group is owned by the library and
+ * must not be freed by the caller.
+ *
+ * @return The shared EC_GROUP for CRYPTOSUPPORT_ECCURVE.
+ */
+EC_GROUP const * keypair_get_group(void) {
+	pthread_once(& keypair_group_once, keypair_group_init);
+
+	return keypair_group;
+}
+
 /**
  * Generate a new public-private ECDH key pair. Uses OpenSSL's secure
  * random functions.
@@ -121,7 +176,7 @@ void keypair_delete(KeyPair * keypair) {
  * @return true if the keys were successfully generated, false o/w.
  */
 bool keypair_generate(KeyPair * keypair) {
-	EC_GROUP * group = NULL;
+	EC_GROUP const * group = NULL;
 	EC_KEY * eckey = NULL;
 	EVP_PKEY * pkey = NULL;
 	int result;
@@ -132,18 +187,16 @@ bool keypair_generate(KeyPair * keypair) {
 
 	/////////////// ECPK Parametners ///////////////
 
-	// TODO: Check when (if?) the group should be freed using EC_GROUP_clear_free
-	group = EC_GROUP_new_by_curve_name(CRYPTOSUPPORT_ECCURVE);
+	// The group parameters are fixed at build time, so the group is set up
+	// once and shared by every key generation; EC_KEY_set_group takes its
+	// own copy
+	pthread_once(& keypair_group_once, keypair_group_init);
+	group = keypair_group;
 	if (group == NULL) {
 		LOG(LOG_ERR, "Error EC not supported: " LIBPICO_STR(CRYPTOSUPPORT_ECCURVE) "\n");
 		success = false;
 	}
 
-	if (success) {
-		EC_GROUP_set_asn1_flag(group, OPENSSL_EC_NAMED_CURVE);
-		EC_GROUP_set_point_conversion_form(group, POINT_CONVERSION_UNCOMPRESSED);
-	}
-
 	/////////////// Key Pair ///////////////
 
 	if (success) {
@@ -259,6 +312,11 @@ void keypair_clear_keys(KeyPair * keypair) {
 		EVP_PKEY_free(keypair->pkey);
 		keypair->pkey = NULL;
 	}
+
+	if (keypair->signctx) {
+		EVP_MD_CTX_destroy(keypair->signctx);
+		keypair->signctx = NULL;
+	}
 }
 
 /**
@@ -405,6 +463,11 @@ EVP_PKEY * keypair_getprivatekey(KeyPair * keypair) {
  */
 void keypair_setprivatekey(KeyPair * keypair, EVP_PKEY * pkey) {
 	keypair->pkey = pkey;
+
+	if (keypair->signctx) {
+		EVP_MD_CTX_destroy(keypair->signctx);
+		keypair->signctx = NULL;
+	}
 }
 
 /**
@@ -429,10 +492,21 @@ void keypair_sign_data(KeyPair * keypair, Buffer const * bufferin, Buffer * buff
 	buffer_set_min_size(bufferout, EVP_MAX_MD_SIZE);
 	length = buffer_get_size(bufferout);
 
-	pkey = keypair_getprivatekey(keypair);
 	digest_type = EVP_sha256();
-	mdctx = EVP_MD_CTX_create();
-	result = EVP_DigestSignInit(mdctx, &pctx, digest_type, NULL, pkey);
+	result = 1;
+	if (keypair->signctx == NULL) {
+		pkey = keypair_getprivatekey(keypair);
+		keypair->signctx = EVP_MD_CTX_create();
+		result = EVP_DigestSignInit(keypair->signctx, &pctx, digest_type, NULL, pkey);
+	}
+
+	if (result == 1) {
+		if (keypair_sign_mdctx == NULL) {
+			keypair_sign_mdctx = EVP_MD_CTX_create();
+		}
+		mdctx = keypair_sign_mdctx;
+		result = EVP_MD_CTX_copy_ex(mdctx, keypair->signctx);
+	}
 
 	if (result == 1) {
 		result = EVP_DigestSignUpdate(mdctx, buffer_get_buffer(bufferin), buffer_get_pos(bufferin));
@@ -446,8 +520,6 @@ void keypair_sign_data(KeyPair * keypair, Buffer const * bufferin, Buffer * buff
 		buffer_set_pos(bufferout, length);
 	}
 
-	EVP_MD_CTX_destroy(mdctx);
-
 	if (result != 1) {
 		LOG(LOG_ERR, "Error signing data: %lu\n", ERR_get_error());
 	}
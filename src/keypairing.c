@@ -77,15 +77,37 @@
 struct _KeyPairing {
 	Json * json;
 	KeyPair * serviceIdentityKey;
+	// Serialized form, rebuilt lazily when the contents change; the JSON
+	// is signed and populated in keypairing_set, so repeat serializations
+	// for the same QR code are plain copies from here
+	Buffer * serialized;
+	bool dirty;
 };
 
 // Function prototypes
 
 void keypairing_getbytestosign(KeyPairing * keypairing, Buffer * buffer);
 void keypairing_sign_self(KeyPairing * keypairing);
+static void keypairing_refresh_serialized(KeyPairing * keypairing);
 
 // Function definitions
 
+/**
+ * An internal function that rebuilds the cached serialized form if the
+ * contents have changed since it was last built. The expensive work, in
+ * particular the identity-key signature, happens in keypairing_set, so
+ * with the cache in place repeat renders of the same pairing QR code cost
+ * a copy rather than a walk of the JSON tree.
+ *
+ * @param keypairing The object to refresh.
+ */
+static void keypairing_refresh_serialized(KeyPairing * keypairing) {
+	if (keypairing->dirty) {
+		json_serialize_buffer(keypairing->json, keypairing->serialized);
+		keypairing->dirty = false;
+	}
+}
+
 /**
  * Create a new instance of the class.
  *
@@ -96,6 +118,8 @@ KeyPairing * keypairing_new() {
 	
 	keypairing = CALLOC(sizeof(KeyPairing), 1);
 	keypairing->json = json_new();
+	keypairing->serialized = buffer_new(0);
+	keypairing->dirty = true;
 	
 	return keypairing;
 }
@@ -110,6 +134,9 @@ void keypairing_delete(KeyPairing * keypairing) {
 		if (keypairing->json) {
 			json_delete(keypairing->json);
 		}
+		if (keypairing->serialized) {
+			buffer_delete(keypairing->serialized);
+		}
 		// The serviceIdentityKey is now deleted when the Shared structure is deleted
 		//if (keypairing->serviceIdentityKey) {
 		//	keypair_delete(keypairing->serviceIdentityKey);
@@ -171,6 +198,7 @@ void keypairing_set(KeyPairing * keypairing, Buffer const * serviceAddress, char
 	// The sig value is added automatically during signing
 	//json_add_string(keypairing->json, "sig", "");
 	keypairing_sign_self(keypairing);
+	keypairing->dirty = true;
 }
 
 /**
@@ -263,7 +291,8 @@ void keypairing_sign_self(KeyPairing * keypairing) {
  * @return The number of bytes needed to store the serialized data
  */
 size_t keypairing_serialize_size(KeyPairing * keypairing) {
-	return json_serialize_size(keypairing->json);
+	keypairing_refresh_serialized(keypairing);
+	return buffer_get_pos(keypairing->serialized);
 }
 
 /**
@@ -274,7 +303,9 @@ size_t keypairing_serialize_size(KeyPairing * keypairing) {
  *
  * The output buffer must be pre-allocated with enough space to hold the
  * serialized data. If the serialized data is too long, it will be truncated.
- * The resulting output is not null-terminated.
+ * The result will be null-terminated as long as the buffer has space for
+ * the terminator after the serialized data (it always does if size is at
+ * least keypairing_serialize_size() + 1).
  *
  * @param keypairing The KeyPairing object to serialize
  * @param buffer A pre-allocated memory buffer for the serialized data to be
@@ -284,7 +315,21 @@ size_t keypairing_serialize_size(KeyPairing * keypairing) {
  * @return The number of bytes stored into the buffer
  */
 size_t keypairing_serialize(KeyPairing * keypairing, char * buffer, size_t size) {
-	return json_serialize(keypairing->json, buffer, size);
+	size_t length;
+
+	keypairing_refresh_serialized(keypairing);
+	length = buffer_get_pos(keypairing->serialized);
+	if (length > size) {
+		length = size;
+	}
+	memcpy(buffer, buffer_get_buffer(keypairing->serialized), length);
+	// Null-terminate when there's room for it; callers allocate size + 1
+	// bytes and pass the result on as a C string
+	if (length < size) {
+		buffer[length] = 0;
+	}
+
+	return length;
 }
 
 /** @} addtogroup Protocol */
@@ -39,6 +39,7 @@
 #include <time.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
 #if defined(_WIN32) || defined(_WIN64) 
  // Defines
 #include <Windows.h>
@@ -55,6 +56,10 @@
 static LibPicoLogFunction gLogFunction;
 static void* gData;
 
+// Read by the LOG macro at every call site; defaults to letting all
+// levels through so behaviour is unchanged until an application lowers it
+int libpico_log_threshold = LOG_DEBUG;
+
 // Function prototypes
 
 // Function definitions
@@ -69,6 +74,18 @@ void libpico_set_log_function(LibPicoLogFunction logFunction, void* data) {
 	gData = data;
 }
 
+/**
+* Sets the maximum priority level that will be logged. Messages with a
+* numerically higher (less severe) level are discarded at the LOG call
+* site without the format arguments being evaluated into a string
+*
+* @param priority The least severe level to log, from 0 to 7 as defined
+*                 by RFC 3164; defaults to LOG_DEBUG (log everything)
+*/
+void libpico_set_log_level(int priority) {
+	libpico_log_threshold = priority;
+}
+
 /**
 * Logs a message with given priority level
 *
@@ -80,25 +97,35 @@ void libpico_log_priority(int priority, const char* format, ...) {
 	// This could be a dynamically allocated string. But I think it is good to 
 	// have a limit. To avoid problems while computing logs.
 	char str[MAX_LOG_MESSAGE];
+	char const * message;
 	va_list args;
 	int totalLen;
 
-	va_start(args, format);
-	totalLen = vsnprintf(str, MAX_LOG_MESSAGE, format, args);
-	va_end(args);
+	if (strchr(format, '%') == NULL) {
+		// Plain message with no conversions, which covers most of the
+		// frequently-hit log calls: emit it as-is and skip the varargs
+		// formatting pass entirely
+		message = format;
+	}
+	else {
+		va_start(args, format);
+		totalLen = vsnprintf(str, MAX_LOG_MESSAGE, format, args);
+		va_end(args);
 
-	if (totalLen >= MAX_LOG_MESSAGE) {
-		snprintf(str + MAX_LOG_MESSAGE - 4, 4, "...");
+		if (totalLen >= MAX_LOG_MESSAGE) {
+			snprintf(str + MAX_LOG_MESSAGE - 4, 4, "...");
+		}
+		message = str;
 	}
 
 	if (gLogFunction == NULL) {
 #if defined(_WIN32) || defined(_WIN64) 
-		printf("%d: %s\n", priority, str);
+		printf("%d: %s\n", priority, message);
 #else
-		syslog(priority, "%s", str);
+		syslog(priority, "%s", message);
 #endif
 	} else {
-		gLogFunction(priority, str, gData);
+		gLogFunction(priority, message, gData);
 	}
 }
 
@@ -47,6 +47,8 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <openssl/ec.h>
 #include "pico/debug.h"
 #include "pico/keypair.h"
@@ -81,12 +83,33 @@ struct _MessagePicoAuth {
 	Buffer * signature;
 	Buffer * mac;
 	Buffer * extraData;
+
+	// Scratch space reused across deserialize calls; the Buffers keep
+	// their storage between messages, so after the first message repeated
+	// deserialization allocates nothing
+	Buffer * scratchBytes;
+	Buffer * scratchMac;
 };
 
+/**
+ * @brief Context for the single-pass deserialization scan
+ *
+ * Collects the fields picked out of the incoming JSON by
+ * messagepicoauth_deserialize_field() as json_scan_buffer() walks the
+ * message, along with a flag per field so missing ones can be reported.
+ */
+typedef struct _MessagePicoAuthScan {
+	MessagePicoAuth * messagepicoauth;
+	bool haveSessionId;
+	bool haveIv;
+	bool haveEncryptedData;
+} MessagePicoAuthScan;
+
 // Function prototypes
 
 void messagepicoauth_get_bytes_to_sign(MessagePicoAuth * messagepicoauth, Buffer * buffer);
 bool messagepicoauth_verify_signature(MessagePicoAuth * messagepicoauth, Buffer * sigin);
+static bool messagepicoauth_deserialize_field(char const * key, size_t keylength, JSONTYPE type, char const * value, size_t valuelength, void * user_data);
 
 // Function definitions
 
@@ -105,6 +128,9 @@ MessagePicoAuth * messagepicoauth_new() {
 	messagepicoauth->signature = buffer_new(0);
 	messagepicoauth->mac = buffer_new(0);
 	messagepicoauth->extraData = buffer_new(0);
+
+	messagepicoauth->scratchBytes = buffer_new(0);
+	messagepicoauth->scratchMac = buffer_new(0);
 	
 	return messagepicoauth;
 }
@@ -131,6 +157,12 @@ void messagepicoauth_delete(MessagePicoAuth * messagepicoauth) {
 		if (messagepicoauth->extraData) {
 			buffer_delete(messagepicoauth->extraData);
 		}
+		if (messagepicoauth->scratchBytes) {
+			buffer_delete(messagepicoauth->scratchBytes);
+		}
+		if (messagepicoauth->scratchMac) {
+			buffer_delete(messagepicoauth->scratchMac);
+		}
 
 		FREE(messagepicoauth);
 	}
@@ -188,8 +220,7 @@ void messagepicoauth_set_extra_data(MessagePicoAuth * messagepicoauth, Buffer co
  * @return true if the message was deserialized correctly, false o/w.
  */
 bool messagepicoauth_deserialize(MessagePicoAuth * messagepicoauth, Buffer * buffer) {
-	Json * json;
-	char const * value;
+	MessagePicoAuthScan scan;
 	Buffer * cleartext;
 	size_t start;
 	size_t next;
@@ -201,43 +232,34 @@ bool messagepicoauth_deserialize(MessagePicoAuth * messagepicoauth, Buffer * buf
 	Buffer * pMacKey;
 	Buffer * picoIdentityPubEncoded;
 
-	json = json_new();
-	result = json_deserialize_buffer(json, buffer);
-	picoPublicKeyBytes = buffer_new(0);
-
-	if (result) {
-		if (json_get_type(json, "sessionId") == JSONTYPE_INTEGER) {
-			messagepicoauth->sessionId = json_get_integer(json, "sessionId");
-		}
-		else {
-			LOG(LOG_ERR, "Missing sessionId\n");
-			result = false;
-		}
+	scan.messagepicoauth = messagepicoauth;
+	scan.haveSessionId = false;
+	scan.haveIv = false;
+	scan.haveEncryptedData = false;
+	result = json_scan_buffer(buffer, messagepicoauth_deserialize_field, & scan);
+	picoPublicKeyBytes = messagepicoauth->scratchBytes;
+	buffer_clear(picoPublicKeyBytes);
+
+	if (result && (scan.haveSessionId == false)) {
+		LOG(LOG_ERR, "Missing sessionId\n");
+		result = false;
 	}
 
-	if (result) {
-		value = json_get_string(json, "iv");
-		if (value) {
-			base64_decode_string(value, messagepicoauth->iv);
-		}
-		else {
-			LOG(LOG_ERR, "Missing iv\n");
-			result = false;
-		}
+	if (result && (scan.haveIv == false)) {
+		LOG(LOG_ERR, "Missing iv\n");
+		result = false;
 	}
 
-	if (result) {
-		value = json_get_string(json, "encryptedData");
-		if (value) {
-			base64_decode_string(value, messagepicoauth->encryptedData);
-		}
-		else {
-			LOG(LOG_ERR, "Missing encryptedData\n");
-			result = false;
-		}
+	if (result && (scan.haveEncryptedData == false)) {
+		LOG(LOG_ERR, "Missing encryptedData\n");
+		result = false;
 	}
 
-	cleartext = buffer_new(0);
+	// Decrypt in place over the base64-decoded ciphertext: the plaintext
+	// overwrites the bytes the decode just wrote while they're still cache
+	// warm, rather than streaming them into a second allocation. The
+	// encrypted form isn't needed again once it has been decrypted
+	cleartext = messagepicoauth->encryptedData;
 	if (result) {
 		pEncKey = shared_get_prover_enc_key(messagepicoauth->shared);
 		result = cryptosupport_decrypt(pEncKey, messagepicoauth->iv, messagepicoauth->encryptedData, cleartext);
@@ -292,8 +314,6 @@ bool messagepicoauth_deserialize(MessagePicoAuth * messagepicoauth, Buffer * buf
 		result = start == buffer_get_pos(cleartext);
 	}
 
-	buffer_delete(cleartext);
-
 	if (result) {
 		// Check the signature
 		result = messagepicoauth_verify_signature(messagepicoauth, messagepicoauth->signature);
@@ -304,28 +324,61 @@ bool messagepicoauth_deserialize(MessagePicoAuth * messagepicoauth, Buffer * buf
 
 	if (result) {
 		// Check the mac
-		mac = buffer_new(0);
+		mac = messagepicoauth->scratchMac;
+		buffer_clear(mac);
 		pMacKey = shared_get_prover_mac_key(messagepicoauth->shared);
 
-		picoIdentityPubEncoded = buffer_new(0);
+		// The public key bytes are finished with, so the scratch Buffer
+		// can be reused for the DER encoding
+		picoIdentityPubEncoded = messagepicoauth->scratchBytes;
+		buffer_clear(picoIdentityPubEncoded);
 		picoIdentityPublicKey = shared_get_pico_identity_public_key(messagepicoauth->shared);
 		cryptosupport_getpublicder(picoIdentityPublicKey, picoIdentityPubEncoded);
 		cryptosupport_generate_mac(pMacKey, picoIdentityPubEncoded, mac);
-		buffer_delete(picoIdentityPubEncoded);
 
 		result = buffer_equals(mac, messagepicoauth->mac);
 		if (!result) {
 			LOG(LOG_ERR, "HMAC failure.\n");
 		}
-		buffer_delete(mac);
 	}
 
-	buffer_delete(picoPublicKeyBytes);
-	json_delete(json);
-
 	return result;
 }
 
+/**
+ * Internal function fired by json_scan_buffer() for each key-value pair of
+ * the incoming message, decoding the fields of the fixed schema straight
+ * from the raw JSON text: the base64 fields are decoded from the slice
+ * without an intermediate copy and sessionId is read with strtoll. The scan
+ * stops early once all three fields have been seen.
+ *
+ * @param key The raw key text, not null-terminated.
+ * @param keylength The length of the key text.
+ * @param type The type of the value.
+ * @param value The raw value text, not null-terminated.
+ * @param valuelength The length of the value text.
+ * @param user_data The MessagePicoAuthScan context for the scan.
+ * @return true to continue the scan, false once every field has been seen.
+ */
+static bool messagepicoauth_deserialize_field(char const * key, size_t keylength, JSONTYPE type, char const * value, size_t valuelength, void * user_data) {
+	MessagePicoAuthScan * scan = (MessagePicoAuthScan *)user_data;
+
+	if ((keylength == 9) && (strncmp(key, "sessionId", 9) == 0) && (type == JSONTYPE_INTEGER)) {
+		scan->messagepicoauth->sessionId = strtoll(value, NULL, 10);
+		scan->haveSessionId = true;
+	}
+	else if ((keylength == 2) && (strncmp(key, "iv", 2) == 0) && (type == JSONTYPE_STRING)) {
+		base64_decode_mem(value, valuelength, scan->messagepicoauth->iv);
+		scan->haveIv = true;
+	}
+	else if ((keylength == 13) && (strncmp(key, "encryptedData", 13) == 0) && (type == JSONTYPE_STRING)) {
+		base64_decode_mem(value, valuelength, scan->messagepicoauth->encryptedData);
+		scan->haveEncryptedData = true;
+	}
+
+	return (scan->haveSessionId && scan->haveIv && scan->haveEncryptedData) == false;
+}
+
 /**
  * Internal function used to pull together the data that the signature covers.
  *
@@ -419,7 +472,6 @@ void messagepicoauth_generate_signature(MessagePicoAuth * messagepicoauth, Buffe
  * @param buffer Buffer to write the JSON message
  */
 void messagepicoauth_serialize(MessagePicoAuth * messagepicoauth, Buffer * buffer) {
-	Json * json;
 	Buffer * encrypted;
 	Buffer * iv;
 	Buffer * encoded;
@@ -428,12 +480,10 @@ void messagepicoauth_serialize(MessagePicoAuth * messagepicoauth, Buffer * buffe
 	Buffer * pMacKey;
 	Buffer * picoIdPubEncoded;
 	KeyPair * picoIdentityKey;
+	char sessionId[32];
 
-	json = json_new();
 	encoded = buffer_new(0);
-	json_add_integer(json, "sessionId", messagepicoauth->sessionId);
 	toEncrypt = buffer_new(0);
-	buffer_clear(encoded);
 
 	// picoPublicKeyBytes
 	picoIdentityKey = shared_get_pico_identity_key(messagepicoauth->shared);
@@ -463,18 +513,30 @@ void messagepicoauth_serialize(MessagePicoAuth * messagepicoauth, Buffer * buffe
 	encrypted = buffer_new(0);
 	pEncKey = shared_get_prover_enc_key(messagepicoauth->shared);
 	cryptosupport_encrypt(pEncKey, iv, toEncrypt, encrypted);
+
+	// The message schema is fixed, so the JSON is emitted directly from
+	// literal template chunks with the encoded fields in between, rather
+	// than building a Json structure just to serialize it once; base64
+	// text never needs escaping and sessionId is the only other variable
+	// piece
+	buffer_clear(buffer);
+	buffer_append_string(buffer, "{\"sessionId\":");
+	snprintf(sessionId, sizeof(sessionId), "%d", messagepicoauth->sessionId);
+	buffer_append_string(buffer, sessionId);
+	buffer_append_string(buffer, ",\"encryptedData\":\"");
 	buffer_clear(encoded);
 	base64_encode_buffer(encrypted, encoded);
-	json_add_buffer(json, "encryptedData", encoded);
+	buffer_append_buffer(buffer, encoded);
+	buffer_append_string(buffer, "\",\"iv\":\"");
 	buffer_clear(encoded);
 	base64_encode_buffer(iv, encoded);
-	json_add_buffer(json, "iv", encoded);
+	buffer_append_buffer(buffer, encoded);
+	buffer_append_string(buffer, "\"}");
+
 	buffer_delete(iv);
 	buffer_delete(encrypted);
 	buffer_delete(toEncrypt);
 	buffer_delete(encoded);
-	json_serialize_buffer(json, buffer);
-	json_delete(json);
 }
 /** @} addtogroup Message */
 
@@ -49,6 +49,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include <openssl/ec.h>
 #include "pico/debug.h"
 #include "pico/keypair.h"
@@ -86,10 +87,31 @@ struct _MessagePicoReAuth {
 	SequenceNumber * sequenceNum;
 	REAUTHSTATE reauthState;
 	Buffer * extraData;
+
+	// Scratch space reused across deserialize calls; the Buffer keeps its
+	// storage between messages, so under continuous authentication the
+	// per-tick deserialization allocates nothing
+	Buffer * scratch;
 };
 
+/**
+ * @brief Context for the single-pass deserialization scan
+ *
+ * Collects the fields picked out of the incoming JSON by
+ * messagepicoreauth_deserialize_field() as json_scan_buffer() walks the
+ * message, along with a flag per field so missing ones can be reported.
+ */
+typedef struct _MessagePicoReAuthScan {
+	MessagePicoReAuth * messagepicoreauth;
+	bool haveSessionId;
+	bool haveIv;
+	bool haveEncryptedData;
+} MessagePicoReAuthScan;
+
 // Function prototypes
 
+static bool messagepicoreauth_deserialize_field(char const * key, size_t keylength, JSONTYPE type, char const * value, size_t valuelength, void * user_data);
+
 // Function definitions
 
 /**
@@ -108,6 +130,8 @@ MessagePicoReAuth * messagepicoreauth_new() {
 	messagepicoreauth->sequenceNum = sequencenumber_new();
 	messagepicoreauth->reauthState = REAUTHSTATE_INVALID;
 	messagepicoreauth->extraData = buffer_new(0);
+
+	messagepicoreauth->scratch = buffer_new(0);
 	
 	return messagepicoreauth;
 }
@@ -131,6 +155,9 @@ void messagepicoreauth_delete(MessagePicoReAuth * messagepicoreauth) {
 		if (messagepicoreauth->extraData) {
 			buffer_delete(messagepicoreauth->extraData);
 		}
+		if (messagepicoreauth->scratch) {
+			buffer_delete(messagepicoreauth->scratch);
+		}
 		if (messagepicoreauth->sequenceNum) {
 			sequencenumber_delete(messagepicoreauth->sequenceNum);
 		}
@@ -218,8 +245,7 @@ void messagepicoreauth_set_reauthstate(MessagePicoReAuth * messagepicoreauth, RE
  * @return true if the message was deserialized correctly, false o/w.
  */
 bool messagepicoreauth_deserialize(MessagePicoReAuth * messagepicoreauth, Buffer * buffer) {
-	Json * json;
-	char const * value;
+	MessagePicoReAuthScan scan;
 	Buffer * cleartext;
 	size_t start;
 	size_t next;
@@ -228,48 +254,38 @@ bool messagepicoreauth_deserialize(MessagePicoReAuth * messagepicoreauth, Buffer
 	Buffer * bytes;
 	size_t length;
 
-	json = json_new();
-	result = json_deserialize_buffer(json, buffer);
+	scan.messagepicoreauth = messagepicoreauth;
+	scan.haveSessionId = false;
+	scan.haveIv = false;
+	scan.haveEncryptedData = false;
+	result = json_scan_buffer(buffer, messagepicoreauth_deserialize_field, & scan);
 
-	if (result) {
-		if (json_get_type(json, "sessionId") == JSONTYPE_INTEGER) {
-			messagepicoreauth->sessionId = json_get_integer(json, "sessionId");
-		}
-		else {
-			LOG(LOG_ERR, "Missing sessionId\n");
-			result = false;
-		}
+	if (result && (scan.haveSessionId == false)) {
+		LOG(LOG_ERR, "Missing sessionId\n");
+		result = false;
 	}
 
-	if (result) {
-		value = json_get_string(json, "iv");
-		if (value) {
-			base64_decode_string(value, messagepicoreauth->iv);
-		}
-		else {
-			LOG(LOG_ERR, "Missing iv\n");
-			result = false;
-		}
+	if (result && (scan.haveIv == false)) {
+		LOG(LOG_ERR, "Missing iv\n");
+		result = false;
 	}
 
-	if (result) {
-		value = json_get_string(json, "encryptedData");
-		if (value) {
-			base64_decode_string(value, messagepicoreauth->encryptedData);
-		}
-		else {
-			LOG(LOG_ERR, "Missing encryptedData\n");
-			result = false;
-		}
+	if (result && (scan.haveEncryptedData == false)) {
+		LOG(LOG_ERR, "Missing encryptedData\n");
+		result = false;
 	}
 
-	cleartext = buffer_new(0);
+	// Decrypt in place over the base64-decoded ciphertext (see
+	// cryptosupport_decrypt for the aliasing rules): under continuous
+	// authentication this path runs every tick, so it shouldn't pay an
+	// allocation and an extra buffer-sized pass per message
+	cleartext = messagepicoreauth->encryptedData;
 	if (result) {
 		//sharedKey = shared_get_shared_key(messagepicoreauth->shared);
 		result = cryptosupport_decrypt(messagepicoreauth->sharedKey, messagepicoreauth->iv, messagepicoreauth->encryptedData, cleartext);
 	}
 
-	bytes = buffer_new(0);
+	bytes = messagepicoreauth->scratch;
 
 	start = 0;
 	if (result) {
@@ -315,12 +331,41 @@ bool messagepicoreauth_deserialize(MessagePicoReAuth * messagepicoreauth, Buffer
 		result = start == buffer_get_pos(cleartext);
 	}
 
-	buffer_delete(bytes);
-	buffer_delete(cleartext);
+	return result;
+}
 
-	json_delete(json);
+/**
+ * Internal function fired by json_scan_buffer() for each key-value pair of
+ * the incoming message, decoding the fields of the fixed schema straight
+ * from the raw JSON text: the base64 fields are decoded from the slice
+ * without an intermediate copy and sessionId is read with strtoll. The scan
+ * stops early once all three fields have been seen.
+ *
+ * @param key The raw key text, not null-terminated.
+ * @param keylength The length of the key text.
+ * @param type The type of the value.
+ * @param value The raw value text, not null-terminated.
+ * @param valuelength The length of the value text.
+ * @param user_data The MessagePicoReAuthScan context for the scan.
+ * @return true to continue the scan, false once every field has been seen.
+ */
+static bool messagepicoreauth_deserialize_field(char const * key, size_t keylength, JSONTYPE type, char const * value, size_t valuelength, void * user_data) {
+	MessagePicoReAuthScan * scan = (MessagePicoReAuthScan *)user_data;
 
-	return result;
+	if ((keylength == 9) && (strncmp(key, "sessionId", 9) == 0) && (type == JSONTYPE_INTEGER)) {
+		scan->messagepicoreauth->sessionId = strtoll(value, NULL, 10);
+		scan->haveSessionId = true;
+	}
+	else if ((keylength == 2) && (strncmp(key, "iv", 2) == 0) && (type == JSONTYPE_STRING)) {
+		base64_decode_mem(value, valuelength, scan->messagepicoreauth->iv);
+		scan->haveIv = true;
+	}
+	else if ((keylength == 13) && (strncmp(key, "encryptedData", 13) == 0) && (type == JSONTYPE_STRING)) {
+		base64_decode_mem(value, valuelength, scan->messagepicoreauth->encryptedData);
+		scan->haveEncryptedData = true;
+	}
+
+	return (scan->haveSessionId && scan->haveIv && scan->haveEncryptedData) == false;
 }
 
 /**
@@ -331,20 +376,18 @@ bool messagepicoreauth_deserialize(MessagePicoReAuth * messagepicoreauth, Buffer
  * @param buffer Memory buffer to store the result in
  */
 void messagepicoreauth_serialize(MessagePicoReAuth * messagepicoreauth, Buffer const * extraData, Buffer * buffer) {
-	Json * json;
 	Buffer * encrypted;
 	Buffer * encoded;
 	Buffer * iv;
 	Buffer * toEncrypt;
 	char reauthState;
+	char sessionId[32];
 
 	// The structure of the message is as follows
 	// {"encryptedData":"B64-ENC","iv":"B64","sessionId":0}
 	// Where encryptedData contains the following sections
 	// char reauthState | length | char sequenceNumber[length] | length | char extraData[length]
 
-	json = json_new();
-
 	// Encrypted data
 	toEncrypt = buffer_new(1);
 
@@ -366,18 +409,24 @@ void messagepicoreauth_serialize(MessagePicoReAuth * messagepicoreauth, Buffer c
 	//sharedKey = shared_get_shared_key(messageservicereauth->shared);
 	cryptosupport_encrypt(messagepicoreauth->sharedKey, iv, toEncrypt, encrypted);
 
-	json_add_integer(json, "sessionId", messagepicoreauth->sessionId);
-
+	// This message is sent once per continuous authentication cycle, so
+	// the fixed schema is emitted directly from literal template chunks
+	// with the encoded fields in between, rather than building a Json
+	// structure just to serialize it once; base64 text never needs
+	// escaping and sessionId is the only other variable piece
+	buffer_clear(buffer);
+	buffer_append_string(buffer, "{\"sessionId\":");
+	snprintf(sessionId, sizeof(sessionId), "%d", messagepicoreauth->sessionId);
+	buffer_append_string(buffer, sessionId);
+	buffer_append_string(buffer, ",\"encryptedData\":\"");
 	encoded = buffer_new(0);
 	base64_encode_buffer(encrypted, encoded);
-	json_add_buffer(json, "encryptedData", encoded);
-
+	buffer_append_buffer(buffer, encoded);
+	buffer_append_string(buffer, "\",\"iv\":\"");
 	buffer_clear(encoded);
 	base64_encode_buffer(iv, encoded);
-	json_add_buffer(json, "iv", encoded);
-
-	json_serialize_buffer(json, buffer);
-	json_delete(json);
+	buffer_append_buffer(buffer, encoded);
+	buffer_append_string(buffer, "\"}");
 
 	buffer_delete(toEncrypt);
 	buffer_delete(encrypted);
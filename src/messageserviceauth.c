@@ -373,6 +373,7 @@ bool messageserviceauth_deserialize(MessageServiceAuth * messageserviceauth, Buf
 	Buffer * serviceIdentityPubEncoded;
 	Nonce * verifierNonce;
 	Buffer * base64;
+	Buffer * decoded;
 
 	json = json_new();
 	result = json_deserialize_buffer(json, buffer);
@@ -399,7 +400,13 @@ bool messageserviceauth_deserialize(MessageServiceAuth * messageserviceauth, Buf
 	if (result) {
 		value = json_get_string(json, "serviceEphemPublicKey");
 		if (value) {
-			shared_set_service_ephemeral_public_key(messageserviceauth->shared, cryptosupport_read_base64_string_public_key(value));
+			// The ephemeral key is fresh for every session, so parse it
+			// directly rather than through the key cache, which only
+			// serves repeatedly presented long-lived keys
+			decoded = buffer_new(base64_decode_size_max_inline(strlen(value)));
+			base64_decode_string(value, decoded);
+			shared_set_service_ephemeral_public_key(messageserviceauth->shared, cryptosupport_read_buffer_public_key(decoded));
+			buffer_delete(decoded);
 		}
 		else {
 			LOG(LOG_ERR, "Missing serviceEphemPublicKey\n");
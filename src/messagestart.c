@@ -46,6 +46,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 //#include <malloc.h>
 #include "pico/debug.h"
 #include "pico/nonce.h"
@@ -77,8 +78,26 @@ struct _MessageStart {
 	unsigned char picoVersion;
 };
 
+/**
+ * @brief Context for the single-pass deserialization scan
+ *
+ * Collects the fields picked out of the incoming JSON by
+ * messagestart_deserialize_field() as json_scan_buffer() walks the
+ * message: the nonce arrives base64-decoded in nonce, the ephemeral key
+ * arrives as raw base64 text in key (its cached parse is keyed on the
+ * base64 form), and a flag per field lets missing ones be reported.
+ */
+typedef struct _MessageStartScan {
+	long long int picoVersion;
+	Buffer * nonce;
+	Buffer * key;
+	bool havePicoVersion;
+} MessageStartScan;
+
 // Function prototypes
 
+static bool messagestart_deserialize_field(char const * key, size_t keylength, JSONTYPE type, char const * value, size_t valuelength, void * user_data);
+
 // Function definitions
 
 /**
@@ -132,18 +151,20 @@ void messagestart_set(MessageStart * messagestart, Shared * shared) {
  * @return true if the message was deserialized correctly, false o/w.
  */
 bool messagestart_deserialize(MessageStart * messagestart, Buffer * buffer) {
-	Json * json;
-	char const * value;
-	Buffer * base64;
+	MessageStartScan scan;
 	Nonce * picoNonce;
+	Buffer * decoded;
 	bool result;
 
-	json = json_new();
-	result = json_deserialize_buffer(json, buffer);
+	scan.picoVersion = 0;
+	scan.nonce = buffer_new(NONCE_DEFAULT_BYTES);
+	scan.key = buffer_new(0);
+	scan.havePicoVersion = false;
+	result = json_scan_buffer(buffer, messagestart_deserialize_field, & scan);
 
 	if (result) {
-		if (json_get_type(json, "picoVersion") == JSONTYPE_INTEGER) {
-			messagestart->picoVersion = json_get_integer(json, "picoVersion");
+		if (scan.havePicoVersion) {
+			messagestart->picoVersion = scan.picoVersion;
 		}
 		else {
 			LOG(LOG_ERR, "Missing picoVersion\n");
@@ -152,13 +173,9 @@ bool messagestart_deserialize(MessageStart * messagestart, Buffer * buffer) {
 	}
 
 	if (result) {
-		value = json_get_string(json, "picoNonce");
-		if (value) {
+		if (buffer_get_pos(scan.nonce) > 0) {
 			picoNonce = shared_get_pico_nonce(messagestart->shared);
-			base64 = buffer_new(NONCE_DEFAULT_BYTES);
-			base64_decode_string(value, base64);
-			nonce_set_buffer(picoNonce, base64);
-			buffer_delete(base64);
+			nonce_set_buffer(picoNonce, scan.nonce);
 		}
 		else {
 			LOG(LOG_ERR, "Missing picoNonce\n");
@@ -167,9 +184,14 @@ bool messagestart_deserialize(MessageStart * messagestart, Buffer * buffer) {
 	}
 
 	if (result) {
-		value = json_get_string(json, "picoEphemeralPublicKey");
-		if (value) {
-			shared_set_pico_ephemeral_public_key(messagestart->shared, cryptosupport_read_base64_string_public_key(value));
+		if (buffer_get_pos(scan.key) > 0) {
+			// The ephemeral key is fresh for every session, so parse it
+			// directly rather than through the key cache, which only
+			// serves repeatedly presented long-lived keys
+			decoded = buffer_new(base64_decode_size_max_inline(buffer_get_pos(scan.key)));
+			base64_decode_buffer(scan.key, decoded);
+			shared_set_pico_ephemeral_public_key(messagestart->shared, cryptosupport_read_buffer_public_key(decoded));
+			buffer_delete(decoded);
 		}
 		else {
 			LOG(LOG_ERR, "Missing picoEphemeralPublicKey\n");
@@ -177,11 +199,46 @@ bool messagestart_deserialize(MessageStart * messagestart, Buffer * buffer) {
 		}
 	}
 
-	json_delete(json);
+	buffer_delete(scan.nonce);
+	buffer_delete(scan.key);
 
 	return result;
 }
 
+/**
+ * Internal function fired by json_scan_buffer() for each key-value pair of
+ * the incoming message, picking out the fields of the fixed schema straight
+ * from the raw JSON text: the nonce is base64-decoded from the slice
+ * without an intermediate copy, the ephemeral key text is kept in its
+ * base64 form for the cached key parser, and picoVersion is read with
+ * strtoll. The scan stops early once all three fields have been seen.
+ *
+ * @param key The raw key text, not null-terminated.
+ * @param keylength The length of the key text.
+ * @param type The type of the value.
+ * @param value The raw value text, not null-terminated.
+ * @param valuelength The length of the value text.
+ * @param user_data The MessageStartScan context for the scan.
+ * @return true to continue the scan, false once every field has been seen.
+ */
+static bool messagestart_deserialize_field(char const * key, size_t keylength, JSONTYPE type, char const * value, size_t valuelength, void * user_data) {
+	MessageStartScan * scan = (MessageStartScan *)user_data;
+
+	if ((keylength == 11) && (strncmp(key, "picoVersion", 11) == 0) && (type == JSONTYPE_INTEGER)) {
+		scan->picoVersion = strtoll(value, NULL, 10);
+		scan->havePicoVersion = true;
+	}
+	else if ((keylength == 9) && (strncmp(key, "picoNonce", 9) == 0) && (type == JSONTYPE_STRING)) {
+		base64_decode_mem(value, valuelength, scan->nonce);
+	}
+	else if ((keylength == 22) && (strncmp(key, "picoEphemeralPublicKey", 22) == 0) && (type == JSONTYPE_STRING)) {
+		buffer_clear(scan->key);
+		buffer_append(scan->key, value, valuelength);
+	}
+
+	return ((scan->havePicoVersion) && (buffer_get_pos(scan->nonce) > 0) && (buffer_get_pos(scan->key) > 0)) == false;
+}
+
 /**
  * Serializes the Start message in JSON format
  *
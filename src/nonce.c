@@ -41,6 +41,10 @@
 #include <stdlib.h>
 //#include <malloc.h>
 #include <string.h>
+#if defined(__linux__)
+#include <sys/random.h>
+#include <pthread.h>
+#endif
 #include <openssl/rand.h>
 #include <openssl/err.h>
 #include "pico/debug.h"
@@ -49,6 +53,17 @@
 
 // Defines
 
+#if defined(__linux__)
+/**
+ * @brief Size of the per-thread pool of buffered randomness
+ *
+ * Each pool refill is one getrandom() call, so a 4096-byte pool serves
+ * 512 default-sized nonces per syscall instead of dropping into the
+ * OpenSSL DRBG, and its lock, for every nonce.
+ */
+#define NONCE_RANDOM_POOL_SIZE (4096)
+#endif
+
 // Structure definitions
 
 /**
@@ -62,14 +77,94 @@
  * The structure typedef is in nonce.h
  */
 struct _Nonce {
+	// Nonces are almost always the standard NONCE_DEFAULT_BYTES long, so
+	// the common case is stored inline and the heap pointer is only used
+	// for oversized caller-supplied values; value being NULL means the
+	// data lives in inlinevalue
+	unsigned char inlinevalue[NONCE_DEFAULT_BYTES];
 	unsigned char * value;
 	size_t length;
 };
 
+// Global variables
+
+#if defined(__linux__)
+// Nonces are public values, so buffering the randomness they are drawn
+// from is safe; the only hazard is a fork duplicating unconsumed pool
+// bytes into the child, which the atfork handler below prevents
+static __thread unsigned char nonce_random_pool[NONCE_RANDOM_POOL_SIZE];
+static __thread size_t nonce_random_pos = 0;
+static __thread size_t nonce_random_level = 0;
+static pthread_once_t nonce_random_once = PTHREAD_ONCE_INIT;
+#endif
+
 // Function prototypes
 
+#if defined(__linux__)
+static void nonce_random_drop_pool(void);
+static void nonce_random_register_fork_handler(void);
+static bool nonce_random_fill(unsigned char * out, size_t length);
+#endif
+
 // Function definitions
 
+#if defined(__linux__)
+/**
+ * An internal function that discards any buffered randomness, run in the
+ * child after a fork so that parent and child never hand out the same
+ * pool bytes.
+ */
+static void nonce_random_drop_pool(void) {
+	nonce_random_pos = 0;
+	nonce_random_level = 0;
+}
+
+/**
+ * An internal function that registers the fork handler; run once per
+ * process through pthread_once.
+ */
+static void nonce_random_register_fork_handler(void) {
+	pthread_atfork(NULL, NULL, nonce_random_drop_pool);
+}
+
+/**
+ * An internal function that copies randomness out of the per-thread
+ * pool, refilling it with getrandom() as needed.
+ *
+ * @param out The area to write the random bytes to.
+ * @param length The number of random bytes required.
+ * @return true on success, false if getrandom() failed, in which case
+ *         the caller should fall back to RAND_bytes().
+ */
+static bool nonce_random_fill(unsigned char * out, size_t length) {
+	ssize_t got;
+	size_t take;
+
+	pthread_once(& nonce_random_once, nonce_random_register_fork_handler);
+
+	while (length > 0) {
+		if (nonce_random_pos >= nonce_random_level) {
+			got = getrandom(nonce_random_pool, NONCE_RANDOM_POOL_SIZE, 0);
+			if (got <= 0) {
+				return false;
+			}
+			nonce_random_pos = 0;
+			nonce_random_level = (size_t)got;
+		}
+		take = nonce_random_level - nonce_random_pos;
+		if (take > length) {
+			take = length;
+		}
+		memcpy(out, nonce_random_pool + nonce_random_pos, take);
+		nonce_random_pos += take;
+		out += take;
+		length -= take;
+	}
+
+	return true;
+}
+#endif
+
 /**
  * Create a new instance of the class.
  *
@@ -111,11 +206,17 @@ void nonce_set_buffer(Nonce * nonce, Buffer * value) {
 
 	if (nonce->value) {
 		FREE(nonce->value);
+		nonce->value = NULL;
 	}
 
-	nonce->length = length;	
-	nonce->value = MALLOC(length);
-	memcpy(nonce->value, buffer_get_buffer(value), length);
+	nonce->length = length;
+	if (length <= NONCE_DEFAULT_BYTES) {
+		memcpy(nonce->inlinevalue, buffer_get_buffer(value), length);
+	}
+	else {
+		nonce->value = MALLOC(length);
+		memcpy(nonce->value, buffer_get_buffer(value), length);
+	}
 }
 
 /**
@@ -130,13 +231,22 @@ void nonce_generate_random(Nonce * nonce) {
 
 	if (nonce->value) {
 		FREE(nonce->value);
+		nonce->value = NULL;
 	}
-	nonce->value = MALLOC(NONCE_DEFAULT_BYTES);
 
-	result = RAND_bytes(nonce->value, NONCE_DEFAULT_BYTES);	
+#if defined(__linux__)
+	if (nonce_random_fill(nonce->inlinevalue, NONCE_DEFAULT_BYTES) == false) {
+		result = RAND_bytes(nonce->inlinevalue, NONCE_DEFAULT_BYTES);
+		if (result != 1) {
+			LOG(LOG_ERR,"Error (randomness): %lu\n", ERR_get_error());
+		}
+	}
+#else
+	result = RAND_bytes(nonce->inlinevalue, NONCE_DEFAULT_BYTES);
 	if (result != 1) {
 		LOG(LOG_ERR,"Error (randomness): %lu\n", ERR_get_error());
 	}
+#endif
 	nonce->length = NONCE_DEFAULT_BYTES;
 }
 
@@ -148,7 +258,7 @@ void nonce_generate_random(Nonce * nonce) {
  * @return Pointer to the start of the buffer
  */
 unsigned char const * nonce_get_buffer(Nonce * nonce) {
-	return nonce->value;
+	return (nonce->value != NULL) ? nonce->value : nonce->inlinevalue;
 }
 
 /**
@@ -44,6 +44,7 @@
  */
 
 #include <stdio.h>
+#include <stdbool.h>
 #include <inttypes.h>
 #include "pico/debug.h"
 #include "pico/buffer.h"
@@ -52,6 +53,16 @@
 
 // Defines
 
+/**
+ * Ceiling on the amount of memory reserved up front from a message's length
+ * prefix. The prefix arrives from the network before any of the data it
+ * describes, so trusting it wholesale would let a peer reserve up to 4 GiB
+ * with a single four-byte write. Messages up to this size get their exact
+ * reservation; anything claiming to be larger grows progressively as the
+ * data actually arrives.
+ */
+#define RVPBUFFER_PRERESERVE_MAX (64 * 1024)
+
 // Structure definitions
 
 /**
@@ -124,15 +135,26 @@ void rvpbuffer_delete(RVPBuffer * rvpbuffer) {
 size_t rvpbuffer_write(void * ptr, size_t size, size_t nmemb, void * userp) {
 	RVPBuffer * rvpbuffer = (RVPBuffer *)userp;
 	size_t pos;
+	bool completedprefix;
 
+	completedprefix = false;
 	pos = 0;
 	while ((rvpbuffer->prefixPos < 4) && (pos < (size * nmemb))) {
 		rvpbuffer->expectedLength |= (uint32_t)((unsigned char*)ptr)[pos] << (3-rvpbuffer->prefixPos) * 8;
 		rvpbuffer->prefixPos++;
 		pos++;
+		completedprefix = (rvpbuffer->prefixPos == 4);
 	}
 
 	if (rvpbuffer->prefixPos >= 4) {
+		if (completedprefix && (rvpbuffer->expectedLength <= RVPBUFFER_PRERESERVE_MAX)) {
+			// The prefix gives the exact length of the message to follow, so
+			// reserve it all now and the chunk appends below never have to
+			// grow the buffer through a chain of reallocations; the length is
+			// attacker-controlled, so reservations beyond the ceiling are left
+			// to grow with the data as it arrives instead
+			buffer_set_min_size(rvpbuffer->buffer, buffer_get_pos(rvpbuffer->buffer) + rvpbuffer->expectedLength + 4);
+		}
 		pos += buffer_append(rvpbuffer->buffer, (char*) ptr + pos, (size * nmemb) - pos);
 	}
 
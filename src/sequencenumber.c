@@ -39,6 +39,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 //#include <malloc.h>
 #include "pico/debug.h"
 #include "pico/log.h"
@@ -67,8 +68,47 @@ struct _SequenceNumber {
 
 // Function prototypes
 
+static uint64_t sequencenumber_load_be64(unsigned char const * bytes);
+static void sequencenumber_store_be64(unsigned char * bytes, uint64_t word);
+
 // Function definitions
 
+/**
+ * Load eight bytes, stored most-significant-byte first, into a 64-bit
+ * integer. Written as shifts so it's portable to any endianness; compilers
+ * turn it into a single load-and-swap on platforms that have one.
+ *
+ * @param bytes The eight bytes to load, MSB first.
+ * @return The value as a 64-bit integer.
+ */
+static uint64_t sequencenumber_load_be64(unsigned char const * bytes) {
+	uint64_t word;
+	int pos;
+
+	word = 0;
+	for (pos = 0; pos < 8; pos++) {
+		word = (word << 8) | bytes[pos];
+	}
+
+	return word;
+}
+
+/**
+ * Store a 64-bit integer as eight bytes, most-significant-byte first. The
+ * counterpart of sequencenumber_load_be64.
+ *
+ * @param bytes Location to write the eight bytes to, MSB first.
+ * @param word The value to store.
+ */
+static void sequencenumber_store_be64(unsigned char * bytes, uint64_t word) {
+	int pos;
+
+	for (pos = 7; pos >= 0; pos--) {
+		bytes[pos] = (unsigned char)(word & 0xff);
+		word >>= 8;
+	}
+}
+
 /**
  * Create a new instance of the class.
  *
@@ -106,40 +146,54 @@ void sequencenumber_random(SequenceNumber * sequencenumber) {
 /**
 * Returns true if both numbers are equal
 * false otherwise
+*
+* The comparison is constant-time: every byte is always examined and the
+* differences are accumulated without branching, so the time taken doesn't
+* reveal how much of a forged sequence number matched. The bytes are
+* compared a word at a time (the length is a multiple of eight), which
+* keeps the constant-time property while running every reauth tick in a
+* handful of operations; memcpy is used for the loads since the values
+* aren't aligned for uint64_t access.
 */
 bool sequencenumber_equals(SequenceNumber * sequencenumber, SequenceNumber * sequencenumber2) {
-	bool equal = true;
-	int i;
-	for (i = 0; i < SEQUENCE_NUMBER_LENGTH; i++) {
-		equal = equal && (sequencenumber->value[i] == sequencenumber2->value[i]);
+	uint64_t diff;
+	uint64_t worda;
+	uint64_t wordb;
+	size_t i;
+
+	diff = 0;
+	for (i = 0; i < SEQUENCE_NUMBER_LENGTH; i += sizeof(uint64_t)) {
+		memcpy(& worda, sequencenumber->value + i, sizeof(uint64_t));
+		memcpy(& wordb, sequencenumber2->value + i, sizeof(uint64_t));
+		diff |= worda ^ wordb;
 	}
-	return equal;
+	return (diff == 0);
 }
 
 /**
  * Increment the sequence number by 1. If the value overflows, it will rotate
  * back round to zero.
  *
+ * The carry is propagated a 64-bit word at a time rather than byte by byte:
+ * the bottom word is incremented, and only if it wraps to zero (once in
+ * 2^64 increments) does the loop touch the next word up. This runs every
+ * reauth tick, so the common case is a single load, add and store.
+ *
  * @param sequencenumber The SequenceNumber object to increment.
  */
 void sequencenumber_increment(SequenceNumber * sequencenumber) {
+	uint64_t word;
 	int pos;
-	unsigned char byte;
-	bool overflow;
-
-	overflow = true;
-	pos = SEQUENCE_NUMBER_LENGTH - 1;
-	while ((overflow) && (pos >= 0)) {
-		byte = sequencenumber->value[pos];
-		if (byte < 0xff) {
-			byte++;
-			overflow = false;
-		}
-		else {
-			byte = 0x00;
+
+	pos = SEQUENCE_NUMBER_LENGTH - sizeof(uint64_t);
+	while (pos >= 0) {
+		word = sequencenumber_load_be64(sequencenumber->value + pos);
+		word++;
+		sequencenumber_store_be64(sequencenumber->value + pos, word);
+		if (word != 0) {
+			break;
 		}
-		sequencenumber->value[pos] = byte;
-		pos--;
+		pos -= sizeof(uint64_t);
 	}
 }
 
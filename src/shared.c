@@ -42,7 +42,11 @@
 
 #include <stdio.h>
 #include <openssl/ec.h>
+#include <openssl/evp.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
 //#include <malloc.h>
 #include "pico/debug.h"
 #include "pico/buffer.h"
@@ -56,6 +60,8 @@
 
 // Defines
 
+#define SERVICE_KEY_CACHE_SIZE (4)
+
 // Structure definitions
 
 /**
@@ -70,6 +76,10 @@
  * The structure typedef is in shared.h
  */
 struct _Shared {
+	// The fields read for every message — the session key buffers, the
+	// nonces and the status — are grouped at the front so they share the
+	// structure's first cache line; the identity and ephemeral keys and
+	// the feedback tracker below are only touched during handshake setup
 	Buffer * pMacKey;
 	Buffer * pEncKey;
 	Buffer * vMacKey;
@@ -79,6 +89,8 @@ struct _Shared {
 	Nonce * serviceNonce;
 	Nonce * picoNonce;
 
+	char status;
+
 	KeyPair * serviceIdentityKey;
 	KeyPair * serviceEphemeralKey;
 	KeyPair * picoIdentityKey;
@@ -86,17 +98,43 @@ struct _Shared {
 
 	Feedback * feedback;
 
-	char status;
-
 	//EC_KEY * picoIdentityPublicKey;
 	//EC_KEY * picoEphemeralPublicKey;
 	//EC_KEY * serviceIdentityPublicKey;
 	//EC_KEY * serviceEphemeralPublicKey;
 };
 
+/**
+ * @brief A cached, already-parsed pair of service identity key files
+ *
+ * Parsing the DER key files through OpenSSL costs far more than a stat(),
+ * so recently loaded keys are kept parsed, keyed on filename and
+ * modification time. An empty slot has a NULL eckey.
+ *
+ * The cache is per-thread so concurrent loads never race the eviction
+ * path's key frees. Note that cached private keys stay parsed in memory
+ * between loads; the verifier's KeyPair holds the active private key for
+ * the service lifetime anyway, so this does not materially widen the
+ * exposure window, but deployments rotating keys should be aware stale
+ * entries persist until evicted.
+ */
+typedef struct _ServiceKeyCacheEntry {
+	char key_public[PATH_MAX];
+	char key_private[PATH_MAX];
+	time_t public_mtime;
+	time_t private_mtime;
+	EC_KEY * eckey;
+	EVP_PKEY * pkey;
+	unsigned int lastused;
+} ServiceKeyCacheEntry;
+
+static __thread ServiceKeyCacheEntry service_key_cache[SERVICE_KEY_CACHE_SIZE];
+static __thread unsigned int service_key_cache_clock = 0;
+
 // Function prototypes
 
 void shared_generate_shared_secrets(Shared * shared);
+static EVP_PKEY * shared_dup_private_key(EVP_PKEY const * pkey);
 
 // Function definitions
 
@@ -265,13 +303,123 @@ void shared_load_or_generate_pico_keys(Shared * shared, char const * key_public,
 bool shared_load_service_keys(Shared * shared, char const * key_public, char const * key_private) {
 	KeyPair * serviceIdentityKey;
 	bool result;
+	struct stat stat_public;
+	struct stat stat_private;
+	ServiceKeyCacheEntry * entry;
+	bool cacheable;
+	int pos;
+	int lru;
 
 	serviceIdentityKey = shared_get_service_identity_key(shared);
+
+	cacheable = (key_public != NULL) && (key_private != NULL)
+		&& (strlen(key_public) < PATH_MAX) && (strlen(key_private) < PATH_MAX)
+		&& (stat(key_public, & stat_public) == 0)
+		&& (stat(key_private, & stat_private) == 0);
+
+	if (cacheable) {
+		for (pos = 0; pos < SERVICE_KEY_CACHE_SIZE; pos++) {
+			entry = & service_key_cache[pos];
+			if ((entry->eckey != NULL)
+				&& (strcmp(entry->key_public, key_public) == 0)
+				&& (strcmp(entry->key_private, key_private) == 0)
+				&& (entry->public_mtime == stat_public.st_mtime)
+				&& (entry->private_mtime == stat_private.st_mtime)) {
+				// Cache hit: hand the keypair copies of the parsed keys
+				// rather than re-reading and re-parsing the DER files
+				keypair_clear_keys(serviceIdentityKey);
+				keypair_setpublickey(serviceIdentityKey, EC_KEY_dup(entry->eckey));
+				keypair_setprivatekey(serviceIdentityKey, shared_dup_private_key(entry->pkey));
+				entry->lastused = ++service_key_cache_clock;
+				return (keypair_getpublickey(serviceIdentityKey) != NULL)
+					&& (keypair_getprivatekey(serviceIdentityKey) != NULL);
+			}
+		}
+	}
+
 	result = keypair_import(serviceIdentityKey, key_public, key_private);
 
+	if (result && cacheable) {
+		// Store copies of the parsed keys, evicting the least recently
+		// used entry if no slot is free
+		lru = 0;
+		for (pos = 0; pos < SERVICE_KEY_CACHE_SIZE; pos++) {
+			if (service_key_cache[pos].eckey == NULL) {
+				lru = pos;
+				break;
+			}
+			if (service_key_cache[pos].lastused < service_key_cache[lru].lastused) {
+				lru = pos;
+			}
+		}
+		entry = & service_key_cache[lru];
+		if (entry->eckey != NULL) {
+			EC_KEY_free(entry->eckey);
+			EVP_PKEY_free(entry->pkey);
+			entry->eckey = NULL;
+			entry->pkey = NULL;
+		}
+		entry->eckey = EC_KEY_dup(keypair_getpublickey(serviceIdentityKey));
+		entry->pkey = shared_dup_private_key(keypair_getprivatekey(serviceIdentityKey));
+		if ((entry->eckey != NULL) && (entry->pkey != NULL)) {
+			strcpy(entry->key_public, key_public);
+			strcpy(entry->key_private, key_private);
+			entry->public_mtime = stat_public.st_mtime;
+			entry->private_mtime = stat_private.st_mtime;
+			entry->lastused = ++service_key_cache_clock;
+		}
+		else {
+			if (entry->eckey != NULL) {
+				EC_KEY_free(entry->eckey);
+			}
+			if (entry->pkey != NULL) {
+				EVP_PKEY_free(entry->pkey);
+			}
+			entry->eckey = NULL;
+			entry->pkey = NULL;
+		}
+	}
+
 	return result;
 }
 
+/**
+ * Internal function that duplicates an elliptic curve private key, so that
+ * the copy can be owned independently of the original. Only EC keys are
+ * supported, which is all the library uses.
+ *
+ * @param pkey The private key to copy
+ * @return A newly allocated copy of the key, or NULL on failure
+ */
+static EVP_PKEY * shared_dup_private_key(EVP_PKEY const * pkey) {
+	EVP_PKEY * copy;
+	EC_KEY * eckey;
+	EC_KEY * eckeycopy;
+
+	if (pkey == NULL) {
+		return NULL;
+	}
+
+	eckey = EVP_PKEY_get1_EC_KEY((EVP_PKEY *)pkey);
+	if (eckey == NULL) {
+		return NULL;
+	}
+	eckeycopy = EC_KEY_dup(eckey);
+	EC_KEY_free(eckey);
+	if (eckeycopy == NULL) {
+		return NULL;
+	}
+
+	copy = EVP_PKEY_new();
+	if (copy == NULL) {
+		EC_KEY_free(eckeycopy);
+		return NULL;
+	}
+	EVP_PKEY_assign_EC_KEY(copy, eckeycopy);
+
+	return copy;
+}
+
 /**
  * Generate a series of shared secrets needed to complete the Pico protocol.
  * The secrets are generated from the ephemeral private key of the service
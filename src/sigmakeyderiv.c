@@ -48,6 +48,11 @@
  * for block $k$, $B_k$$, is $B_{k - 1} || k || N_P || N_S$, except for the 
  * first block, where the previous block component is ommitted.
  * 
+ * This block structure is fixed by the protocol (the Pico app derives the
+ * same keys), so it can't be swapped for another KDF; the HMAC-SHA256 at
+ * its core goes through OpenSSL's EVP machinery, which dispatches to the
+ * SHA hardware instructions where the CPU provides them.
+ * 
  */
 
 /** \addtogroup Crypto
@@ -92,6 +97,10 @@ struct _SigmaKeyDeriv {
 	Buffer * nonces;
 	int currentBlockNumber;
 
+	// Scratch for the per-block MAC message, reused across blocks so key
+	// expansion doesn't allocate per block
+	Buffer * blockMessage;
+
 	HMAC_CTX * ctx;
 };
 
@@ -116,7 +125,9 @@ SigmaKeyDeriv * sigmakeyderiv_new() {
 	sigmakeyderiv->currentBlock = buffer_new(sigmakeyderiv->blockSizeInBytes);
 	sigmakeyderiv->sharedSecret = buffer_new(0);
 	sigmakeyderiv->nonces = buffer_new(0);
+	sigmakeyderiv->blockMessage = buffer_new(0);
 	sigmakeyderiv->ctx = CALLOC(sizeof(HMAC_CTX), 1);
+	HMAC_CTX_init(sigmakeyderiv->ctx);
 
 	return sigmakeyderiv;
 }
@@ -141,6 +152,9 @@ void sigmakeyderiv_delete(SigmaKeyDeriv * sigmakeyderiv) {
 		if (sigmakeyderiv->nonces) {
 			buffer_delete(sigmakeyderiv->nonces);
 		}
+		if (sigmakeyderiv->blockMessage) {
+			buffer_delete(sigmakeyderiv->blockMessage);
+		}
 
 		FREE(sigmakeyderiv);
 	}
@@ -177,7 +191,8 @@ void sigmakeyderiv_set(SigmaKeyDeriv * sigmakeyderiv, Buffer * sharedSecret, Non
 	randomness = buffer_new(EVP_MAX_MD_SIZE);
 	sigmakeyderiv_extract_randomness(sigmakeyderiv, randomness);
 
-	HMAC_CTX_init(sigmakeyderiv->ctx);
+	// The context was initialised in sigmakeyderiv_new(); re-keying it
+	// here covers both the first use and any later sigmakeyderiv_set()
 	HMAC_Init_ex(sigmakeyderiv->ctx, buffer_get_buffer(randomness), buffer_get_pos(randomness), EVP_sha256(), NULL);
 	
 	buffer_delete(randomness);
@@ -197,22 +212,17 @@ void sigmakeyderiv_set(SigmaKeyDeriv * sigmakeyderiv, Buffer * sharedSecret, Non
  * @param bufferout The buffer to write the 32-bytes of random data to
  */
 void sigmakeyderiv_extract_randomness(SigmaKeyDeriv * sigmakeyderiv, Buffer * bufferout) {
-	HMAC_CTX * ctx;
 	unsigned int len;
 
-	ctx = CALLOC(sizeof(HMAC_CTX), 1);
-
-	HMAC_CTX_init(ctx);
-	HMAC_Init_ex(ctx, buffer_get_buffer(sigmakeyderiv->nonces), buffer_get_pos(sigmakeyderiv->nonces), EVP_sha256(), NULL);
-	HMAC_Update(ctx, (unsigned char * const)buffer_get_buffer(sigmakeyderiv->sharedSecret), buffer_get_pos(sigmakeyderiv->sharedSecret));
+	// The object's own context can be borrowed for the extraction: it is
+	// re-keyed with the extracted randomness immediately afterwards by
+	// sigmakeyderiv_set(), so there's no need to allocate a fresh one
+	HMAC_Init_ex(sigmakeyderiv->ctx, buffer_get_buffer(sigmakeyderiv->nonces), buffer_get_pos(sigmakeyderiv->nonces), EVP_sha256(), NULL);
+	HMAC_Update(sigmakeyderiv->ctx, (unsigned char * const)buffer_get_buffer(sigmakeyderiv->sharedSecret), buffer_get_pos(sigmakeyderiv->sharedSecret));
 
 	buffer_set_min_size(bufferout, EVP_MAX_MD_SIZE);
-	HMAC_Final(ctx, (unsigned char * const)buffer_get_buffer(bufferout), &len);
+	HMAC_Final(sigmakeyderiv->ctx, (unsigned char * const)buffer_get_buffer(bufferout), &len);
 	buffer_set_pos(bufferout, len);
-
-	HMAC_CTX_cleanup(ctx);
-
-	FREE(ctx);
 }
 
 /**
@@ -237,7 +247,8 @@ void sigmakeyderiv_next_block(SigmaKeyDeriv * sigmakeyderiv) {
 		LOG(LOG_ERR, "Error generating shared key data: no more blocks\n");
 	}
 
-	newBlockMacMessage = buffer_new(0);
+	newBlockMacMessage = sigmakeyderiv->blockMessage;
+	buffer_clear(newBlockMacMessage);
 
 	if (sigmakeyderiv->currentBlockNumber == SIGMAKEYDERIV_START_BLOCK_NUMBER) {
 		buffer_append_buffer(newBlockMacMessage, sigmakeyderiv->nonces);
@@ -260,8 +271,6 @@ void sigmakeyderiv_next_block(SigmaKeyDeriv * sigmakeyderiv) {
 	buffer_set_pos(sigmakeyderiv->currentBlock, len);
 
 	HMAC_Init_ex(sigmakeyderiv->ctx, NULL, 0, NULL, NULL);
-
-	buffer_delete(newBlockMacMessage);
 }
 
 /**
@@ -97,7 +97,7 @@ bool sigmaprover(Shared * shared, RVPChannel * channel, Buffer const * sendExtra
 	feedback = shared_get_feedback(shared);
 	feedback_set_special_removeqr(feedback, FEEDBACKAUTHPROVER_CONTACTSERVICE);
 
-	result = shared_next_stage(shared, authProverFeedback[FEEDBACKAUTHPROVER_CONTACTSERVICE]);
+	result = shared_next_stage(shared, feedback_prover_description(FEEDBACKAUTHPROVER_CONTACTSERVICE));
 
 	if (result) {
 		LOG(LOG_INFO, "Send MessageStart\n");
@@ -110,7 +110,7 @@ bool sigmaprover(Shared * shared, RVPChannel * channel, Buffer const * sendExtra
 	}
 
 	if (result) {
-		result = shared_next_stage(shared, authProverFeedback[FEEDBACKAUTHPROVER_AUTHSERVICE]);
+		result = shared_next_stage(shared, feedback_prover_description(FEEDBACKAUTHPROVER_AUTHSERVICE));
 	}
 
 	if (result) {
@@ -133,7 +133,7 @@ bool sigmaprover(Shared * shared, RVPChannel * channel, Buffer const * sendExtra
 	}
 
 	if (result) {
-		result = shared_next_stage(shared, authProverFeedback[FEEDBACKAUTHPROVER_AUTHPICO]);
+		result = shared_next_stage(shared, feedback_prover_description(FEEDBACKAUTHPROVER_AUTHPICO));
 	}
 
 	if (result) {
@@ -148,7 +148,7 @@ bool sigmaprover(Shared * shared, RVPChannel * channel, Buffer const * sendExtra
 	}
 
 	if (result) {
-		result = shared_next_stage(shared, authProverFeedback[FEEDBACKAUTHPROVER_AWAITRESULT]);
+		result = shared_next_stage(shared, feedback_prover_description(FEEDBACKAUTHPROVER_AWAITRESULT));
 	}
 
 	messagestatus = messagestatus_new();
@@ -179,7 +179,7 @@ bool sigmaprover(Shared * shared, RVPChannel * channel, Buffer const * sendExtra
 	buffer_delete(buffer);
 
 	if (result) {
-		result = shared_next_stage(shared, authProverFeedback[FEEDBACKAUTHPROVER_DONE]);
+		result = shared_next_stage(shared, feedback_prover_description(FEEDBACKAUTHPROVER_DONE));
 	}
 
 	return result;
@@ -30,6 +30,14 @@
  * The sigmaverifier function performs the service's (verifier's) half of the
  * SIGMA-I protocol over the Rendezvous Point channel provided.
  * 
+ * Each call drives exactly one handshake to completion. A service
+ * handling many Picos should run one call per connection on its own
+ * thread: the mutable state lives in the per-connection Shared object
+ * and the channel, and the library's caches (the cipher, digest and MAC
+ * contexts and the parsed-key caches in cryptosupport.c, and the service
+ * key cache in shared.c) are all per-thread, so concurrent handshakes
+ * share no library state and need no locks of their own.
+ * 
  */
 
 /** \addtogroup Protocol
@@ -156,7 +164,7 @@ bool sigmaverifier_session(Shared * shared, RVPChannel * channel, Users * author
 	feedback_set_special_removeqr(feedback, FEEDBACKAUTHVERIFIER_CONTACTEDBYPICO);
 
 	if (result) {
-		result = shared_next_stage(shared, authVerifierFeedback[FEEDBACKAUTHVERIFIER_GENKEYS]);
+		result = shared_next_stage(shared, feedback_verifier_description(FEEDBACKAUTHVERIFIER_GENKEYS));
 	}
 
 	if (result) {
@@ -164,7 +172,7 @@ bool sigmaverifier_session(Shared * shared, RVPChannel * channel, Users * author
 		serviceEphemeralKey = shared_get_service_ephemeral_key(shared);
 		keypair_generate(serviceEphemeralKey);
 
-		result = shared_next_stage(shared, authVerifierFeedback[FEEDBACKAUTHVERIFIER_WAITFORPICO]);
+		result = shared_next_stage(shared, feedback_verifier_description(FEEDBACKAUTHVERIFIER_WAITFORPICO));
 	}
 
 	if (result) {
@@ -182,7 +190,7 @@ bool sigmaverifier_session(Shared * shared, RVPChannel * channel, Users * author
 	}
 
 	if (result) {
-		result = shared_next_stage(shared, authVerifierFeedback[FEEDBACKAUTHVERIFIER_CONTACTEDBYPICO]);
+		result = shared_next_stage(shared, feedback_verifier_description(FEEDBACKAUTHVERIFIER_CONTACTEDBYPICO));
 	}
 	
 
@@ -195,7 +203,7 @@ bool sigmaverifier_session(Shared * shared, RVPChannel * channel, Users * author
 	}
 
 	if (result) {
-		result = shared_next_stage(shared, authVerifierFeedback[FEEDBACKAUTHVERIFIER_AUTHSERVICE]);
+		result = shared_next_stage(shared, feedback_verifier_description(FEEDBACKAUTHVERIFIER_AUTHSERVICE));
 	}
 
 	if (result) {
@@ -211,7 +219,7 @@ bool sigmaverifier_session(Shared * shared, RVPChannel * channel, Users * author
 	}
 	
 	if (result) {
-		result = shared_next_stage(shared, authVerifierFeedback[FEEDBACKAUTHVERIFIER_AUTHPICO]);
+		result = shared_next_stage(shared, feedback_verifier_description(FEEDBACKAUTHVERIFIER_AUTHPICO));
 	}
 
 	if (result) {
@@ -224,7 +232,7 @@ bool sigmaverifier_session(Shared * shared, RVPChannel * channel, Users * author
 	}
 
 	if (result) {
-		shared_next_stage(shared, authVerifierFeedback[FEEDBACKAUTHVERIFIER_AUTHRECEIVED]);
+		shared_next_stage(shared, feedback_verifier_description(FEEDBACKAUTHVERIFIER_AUTHRECEIVED));
 	}
 
 	if (result) {
@@ -239,7 +247,7 @@ bool sigmaverifier_session(Shared * shared, RVPChannel * channel, Users * author
 	}
 
 	if (result) {
-		result = shared_next_stage(shared, authVerifierFeedback[FEEDBACKAUTHVERIFIER_FINALISING]);
+		result = shared_next_stage(shared, feedback_verifier_description(FEEDBACKAUTHVERIFIER_FINALISING));
 	}
 
 	if ((result) && (authorizedUsers != NULL)) {
@@ -297,7 +305,7 @@ bool sigmaverifier_session(Shared * shared, RVPChannel * channel, Users * author
 	buffer_delete(buffer);
 
 	if (result) {
-		result = shared_next_stage(shared, authVerifierFeedback[FEEDBACKAUTHVERIFIER_DONE]);
+		result = shared_next_stage(shared, feedback_verifier_description(FEEDBACKAUTHVERIFIER_DONE));
 	}
 
 
@@ -74,6 +74,9 @@ struct _User {
 	Buffer * name;
 	Buffer * commitment;
 	EC_KEY * picoIdentityPublicKey;
+	// DER encoding of picoIdentityPublicKey, cached when the user is set
+	// so key searches don't have to re-encode it for every comparison
+	Buffer * publicKeyDer;
 	Buffer * symmetricKey;
 	Buffer * comment;
 	User * next;
@@ -152,6 +155,7 @@ static User * user_new() {
 	user->name = buffer_new(0);
 	user->commitment = buffer_new(0);
 	user->picoIdentityPublicKey = NULL;
+	user->publicKeyDer = buffer_new(0);
 	user->symmetricKey = buffer_new(0);
 	user->comment = buffer_new(0);
 	user->next = NULL;
@@ -178,6 +182,10 @@ static void user_delete(User * user) {
 			// Reduce reference count and free if zero
 			EC_KEY_free(user->picoIdentityPublicKey);
 		}
+		if (user->publicKeyDer) {
+			buffer_delete(user->publicKeyDer);
+			user->publicKeyDer = NULL;
+		}
 		if (user->symmetricKey) {
 			buffer_delete(user->symmetricKey);
 			user->symmetricKey = NULL;
@@ -219,6 +227,9 @@ static void user_set(User * user, char const * name, EC_KEY * picoIdentityPublic
 	// Increase reference count
 	EC_KEY_up_ref(user->picoIdentityPublicKey);
 
+	buffer_clear(user->publicKeyDer);
+	cryptosupport_getpublicder(user->picoIdentityPublicKey, user->publicKeyDer);
+
 	result = cryptosupport_generate_commitment(user->picoIdentityPublicKey, user->commitment);
 	if (result == false) {
 		LOG(LOG_ERR, "Error generating user's Pico commitment");
@@ -645,7 +656,6 @@ static User * user_search_by_public_key(User * first, EC_KEY * picoIdentityPubli
 	User * found;
 	User * current;
 	Buffer * publicKey;
-	Buffer * publicCurrent;
 
 	commitment = buffer_new(0);
 	result = cryptosupport_generate_commitment(picoIdentityPublicKey, commitment);
@@ -653,17 +663,15 @@ static User * user_search_by_public_key(User * first, EC_KEY * picoIdentityPubli
 	found = NULL;
 	if (result == true) {
 		publicKey = buffer_new(0);
-		publicCurrent = buffer_new(0);
 		cryptosupport_getpublicder(picoIdentityPublicKey, publicKey);
 
 		current = first;
 		while ((found == NULL) && (current != NULL)) {
 			result = buffer_equals(commitment, current->commitment);
 			if (result == true) {
-				// Perform full key comparison
-				buffer_clear(publicCurrent);
-				cryptosupport_getpublicder(current->picoIdentityPublicKey, publicCurrent);
-				result = buffer_equals(publicKey, publicCurrent);
+				// Perform full key comparison against the DER encoding
+				// cached when the user was added
+				result = buffer_equals(publicKey, current->publicKeyDer);
 				if (result == true) {
 					// The public keys match
 					found = current;
@@ -672,7 +680,6 @@ static User * user_search_by_public_key(User * first, EC_KEY * picoIdentityPubli
 
 			current = current->next;
 		}
-		buffer_delete(publicCurrent);
 		buffer_delete(publicKey);
 	}
 
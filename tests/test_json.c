@@ -37,12 +37,44 @@
 
 // Defines
 
+#define SCAN_MAX_PAIRS (8)
+
 // Structure definitions
 
+/**
+ * Record of the callbacks fired during a json_scan() call, so the tests can
+ * check the pairs arrive in order with the right types and raw slices. The
+ * stopafter field makes the callback return false once that many pairs have
+ * been seen, to test stopping the scan early.
+ */
+typedef struct _ScanRecord {
+	int count;
+	int stopafter;
+	char key[SCAN_MAX_PAIRS][64];
+	JSONTYPE type[SCAN_MAX_PAIRS];
+	char value[SCAN_MAX_PAIRS][128];
+} ScanRecord;
+
 // Function prototypes
 
 // Function definitions
 
+static bool scan_record_callback(char const * key, size_t keylength, JSONTYPE type, char const * value, size_t valuelength, void * user_data) {
+	ScanRecord * record = (ScanRecord *)user_data;
+
+	ck_assert(record->count < SCAN_MAX_PAIRS);
+	ck_assert(keylength < sizeof(record->key[0]));
+	ck_assert(valuelength < sizeof(record->value[0]));
+	memcpy(record->key[record->count], key, keylength);
+	record->key[record->count][keylength] = '\0';
+	record->type[record->count] = type;
+	memcpy(record->value[record->count], value, valuelength);
+	record->value[record->count][valuelength] = '\0';
+	record->count++;
+
+	return (record->stopafter == 0) || (record->count < record->stopafter);
+}
+
 void test_serialize(Json * json, char * expected) {
 	size_t size = json_serialize_size(json);
 	char* serialized = malloc(size+1);
@@ -498,6 +530,128 @@ START_TEST (empty) {
 }
 END_TEST
 
+START_TEST (scan_fixed_schema) {
+	// The shape the message deserializers rely on: string, integer and
+	// decimal fields reported in input order with pointers into the input
+	char const * serialized = "{\"picoEphemeralPublicKey\":\"QkFTRTY0S0VZ\", \"picoNonce\" : \"Tk9OQ0U=\",\"picoVersion\":2,\"weight\":1.5}";
+	ScanRecord record = {0};
+	bool result;
+
+	result = json_scan(serialized, strlen(serialized), scan_record_callback, & record);
+	ck_assert(result);
+	ck_assert_int_eq(record.count, 4);
+
+	ck_assert_str_eq(record.key[0], "picoEphemeralPublicKey");
+	ck_assert_int_eq(record.type[0], JSONTYPE_STRING);
+	ck_assert_str_eq(record.value[0], "QkFTRTY0S0VZ");
+
+	ck_assert_str_eq(record.key[1], "picoNonce");
+	ck_assert_int_eq(record.type[1], JSONTYPE_STRING);
+	ck_assert_str_eq(record.value[1], "Tk9OQ0U=");
+
+	ck_assert_str_eq(record.key[2], "picoVersion");
+	ck_assert_int_eq(record.type[2], JSONTYPE_INTEGER);
+	ck_assert_str_eq(record.value[2], "2");
+
+	ck_assert_str_eq(record.key[3], "weight");
+	ck_assert_int_eq(record.type[3], JSONTYPE_DECIMAL);
+	ck_assert_str_eq(record.value[3], "1.5");
+
+	// An empty object parses cleanly but fires no callbacks
+	record.count = 0;
+	result = json_scan("{}", 2, scan_record_callback, & record);
+	ck_assert(result);
+	ck_assert_int_eq(record.count, 0);
+}
+END_TEST
+
+START_TEST (scan_early_stop) {
+	// Returning false from the callback stops the scan without it being
+	// treated as a parse error, so a deserializer with a fixed schema can
+	// bail as soon as it has all its fields
+	char const * serialized = "{\"sessionId\":0,\"iv\":\"QUJD\",\"encryptedData\":\"REVG\"}";
+	ScanRecord record = {0};
+	bool result;
+
+	record.stopafter = 2;
+	result = json_scan(serialized, strlen(serialized), scan_record_callback, & record);
+	ck_assert(result);
+	ck_assert_int_eq(record.count, 2);
+	ck_assert_str_eq(record.key[0], "sessionId");
+	ck_assert_str_eq(record.key[1], "iv");
+}
+END_TEST
+
+START_TEST (scan_escaped_strings) {
+	// Escape sequences are left as they appear in the input; in particular
+	// an escaped quote must not end the key or value slice
+	char const * serialized = "{\"say \\\"hi\\\"\":\"a \\\\ b \\\"c\\\"\",\"next\":1}";
+	ScanRecord record = {0};
+	bool result;
+
+	result = json_scan(serialized, strlen(serialized), scan_record_callback, & record);
+	ck_assert(result);
+	ck_assert_int_eq(record.count, 2);
+	ck_assert_str_eq(record.key[0], "say \\\"hi\\\"");
+	ck_assert_int_eq(record.type[0], JSONTYPE_STRING);
+	ck_assert_str_eq(record.value[0], "a \\\\ b \\\"c\\\"");
+	ck_assert_str_eq(record.key[1], "next");
+}
+END_TEST
+
+START_TEST (scan_sublist) {
+	// Sublists are reported whole, bounded by their outer braces; braces
+	// inside nested string values must not unbalance the count, and the
+	// scan carries on with the pair after the sublist
+	char const * serialized = "{\"a\":1,\"sub\":{\"x\":\"}{\",\"deeper\":{\"y\":2}},\"b\":\"last\"}";
+	ScanRecord record = {0};
+	bool result;
+
+	result = json_scan(serialized, strlen(serialized), scan_record_callback, & record);
+	ck_assert(result);
+	ck_assert_int_eq(record.count, 3);
+	ck_assert_str_eq(record.key[0], "a");
+	ck_assert_int_eq(record.type[0], JSONTYPE_INTEGER);
+	ck_assert_str_eq(record.key[1], "sub");
+	ck_assert_int_eq(record.type[1], JSONTYPE_SUBLIST);
+	ck_assert_str_eq(record.value[1], "{\"x\":\"}{\",\"deeper\":{\"y\":2}}");
+	ck_assert_str_eq(record.key[2], "b");
+	ck_assert_int_eq(record.type[2], JSONTYPE_STRING);
+	ck_assert_str_eq(record.value[2], "last");
+}
+END_TEST
+
+START_TEST (scan_malformed) {
+	char const * broken[] = {
+		"",
+		"   ",
+		"nonsense",
+		"[1,2]",
+		"{",
+		"{\"key\"",
+		"{\"key\":",
+		"{\"key\" 1}",
+		"{\"key\":}",
+		"{\"key\":1",
+		"{\"key\":\"unterminated}",
+		"{\"key\\\":1}",
+		"{\"key\":\"value\"",
+		"{\"key\":\"value\" \"other\":2}",
+		"{\"key\":{\"nested\":1}",
+		"{\"key\":{\"nested\":\"}\"}",
+	};
+	ScanRecord record;
+	bool result;
+	size_t i;
+
+	for (i = 0; i < (sizeof(broken) / sizeof(broken[0])); i++) {
+		memset(& record, 0, sizeof(record));
+		result = json_scan(broken[i], strlen(broken[i]), scan_record_callback, & record);
+		ck_assert(result == false);
+	}
+}
+END_TEST
+
 int main (void) {
 	int number_failed;
 	Suite * s;
@@ -517,6 +671,11 @@ int main (void) {
 	tcase_add_test(tc, escaping);
 	tcase_add_test(tc, unescaping);
 	tcase_add_test(tc, empty);
+	tcase_add_test(tc, scan_fixed_schema);
+	tcase_add_test(tc, scan_early_stop);
+	tcase_add_test(tc, scan_escaped_strings);
+	tcase_add_test(tc, scan_sublist);
+	tcase_add_test(tc, scan_malformed);
 	suite_add_tcase(s, tc);
 	sr = srunner_create(s);
 